@@ -1,5 +1,7 @@
 #ifndef _CILK_API_H
 #define _CILK_API_H
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -10,6 +12,27 @@ extern int __cilkrts_atexit(void (*callback)(void));
 extern unsigned __cilkrts_get_nworkers(void);
 extern unsigned __cilkrts_get_worker_number(void) __attribute__((deprecated));
 struct __cilkrts_worker *__cilkrts_get_tls_worker(void);
+/* The ID of a worker, less than __cilkrts_get_nworkers(). */
+extern unsigned __cilkrts_get_worker_id(struct __cilkrts_worker *w);
+
+/* Allocate from the free lists of the worker running the caller, without
+ * taking a lock.  Memory may be freed by any worker, or by the thread that
+ * runs Cilk code between Cilkified regions, and the size passed to
+ * __cilkrts_worker_free must be the size that was allocated.  Blocks are
+ * aligned to a cache line.  Threads the runtime does not know about must
+ * not call these while a Cilkified region is running. */
+extern void *__cilkrts_worker_malloc(size_t size)
+    __attribute__((malloc, alloc_size(1)));
+extern void __cilkrts_worker_free(void *ptr, size_t size);
+
+/* Return memory the runtime has cached for fibers and internal objects to
+ * the system, keeping up to CILK_TRIM_FIBERS free fibers and
+ * CILK_TRIM_MEMORY free bytes per NUMA node.  If either variable is set,
+ * the runtime also trims at the end of each Cilkified region.  This call
+ * also empties the caches of the worker that exited the last region.  It
+ * must be called outside a Cilkified region; during one it does nothing.
+ * Returns the number of bytes released. */
+extern size_t __cilkrts_trim(void);
 
 
 #if defined(__cilk_pedigrees__) || defined(ENABLE_CILKRTS_PEDIGREE)
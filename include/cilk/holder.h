@@ -55,7 +55,9 @@
 #ifndef HOLDER_H_INCLUDED
 #define HOLDER_H_INCLUDED
 
+#include <cilk/cilk_api.h>
 #include <cilk/reducer.h>
+#include <cstddef>
 #include <memory>
 #include <utility>
 
@@ -270,6 +272,18 @@ namespace cilk {
      * in a piece of code.  An indeterminate holder is also useful for keeping
      * cached data similar to the way some applications might use thread-local
      * storage.
+     *
+     * A policy of 'holder_keep_persistent' reduces like
+     * 'holder_keep_indeterminate', but does not destroy a view when the
+     * runtime is done with it.  The view is kept, still constructed, in a
+     * cache belonging to the worker that released it, and that worker hands
+     * it out again the next time it needs a new view, after a later steal or
+     * in a later parallel region.  Views that hold large scratch buffers are
+     * therefore constructed about once per worker rather than once per
+     * steal.  A reused view keeps whatever state it was left in, unless a
+     * reset function is installed with 'holder::set_reset'.  The number of
+     * cached views can be bounded with 'holder::set_cache_limit', and the
+     * cache emptied with 'holder::trim_cache'.
      */
     enum holder_policy {
         holder_keep_indeterminate,
@@ -277,8 +291,9 @@ namespace cilk {
         holder_keep_last_copy,
         holder_keep_last_swap,
 #ifdef __CILKRTS_RVALUE_REFERENCES
-        holder_keep_last_move
+        holder_keep_last_move,
 #endif
+        holder_keep_persistent
     };
 
     namespace internal {
@@ -731,6 +746,162 @@ namespace cilk {
             // std::allocator_traits<Allocator>::construct(a, p, m_functor());
         }
 
+        /**
+         * Per-worker caches of constructed views, for holders with the
+         * 'holder_keep_persistent' policy.  Each view is allocated in a slot
+         * that records whether it is constructed.  A slot released on a
+         * worker goes onto that worker's free list, and the worker takes
+         * its next view from the list.  A worker touches only its own list,
+         * so the lists need no locking.
+         */
+        template <typename Type, typename Allocator>
+        class holder_view_cache
+        {
+            struct slot
+            {
+                slot* next;
+                bool  constructed;
+                // Aligned as Type, which may be over-aligned.
+                storage_for_object<Type> view;
+
+                Type* object() { return &view.object(); }
+
+                static slot* of(Type* p) {
+                    return reinterpret_cast<slot*>(
+                        reinterpret_cast<char*>(p) - offsetof(slot, view));
+                }
+            };
+
+            // A worker's free list, on a cache line of its own.
+            struct worker_list
+            {
+                slot*       head;
+                std::size_t count;
+                std::size_t limit;
+                char        pad[64 - sizeof(slot*) - 2 * sizeof(std::size_t)];
+            };
+
+            typedef typename Allocator::template rebind<slot>::other
+                slot_alloc;
+            typedef typename Allocator::template rebind<worker_list>::other
+                list_alloc;
+
+            slot_alloc   m_slot_alloc;
+            list_alloc   m_list_alloc;
+            worker_list* m_lists;
+            unsigned     m_nworkers;
+            void       (*m_reset)(Type&);
+
+            // Non-copiable
+            holder_view_cache(const holder_view_cache&);
+            holder_view_cache& operator=(const holder_view_cache&);
+
+            // The list of the calling worker, or null if the caller is not
+            // a worker or the worker was not counted when the cache was
+            // made.  Threads outside the runtime bypass the cache, since
+            // they may run concurrently with any worker.
+            worker_list* my_list() const {
+                __cilkrts_worker* w = __cilkrts_get_tls_worker();
+                if (!w)
+                    return 0;
+                unsigned self = __cilkrts_get_worker_id(w);
+                return self < m_nworkers ? &m_lists[self] : 0;
+            }
+
+            void free_slot(slot* s) {
+                if (s->constructed)
+                    s->object()->~Type();
+                m_slot_alloc.deallocate(s, 1);
+            }
+
+        public:
+            explicit holder_view_cache(const Allocator& a)
+                : m_slot_alloc(a)
+                , m_list_alloc(a)
+                , m_lists(0)
+                , m_nworkers(__cilkrts_get_nworkers())
+                , m_reset(0)
+            {
+                if (m_nworkers) {
+                    m_lists = m_list_alloc.allocate(m_nworkers);
+                    for (unsigned i = 0; i < m_nworkers; ++i) {
+                        m_lists[i].head = 0;
+                        m_lists[i].count = 0;
+                    }
+                }
+                set_limit(std::size_t(-1));
+            }
+
+            ~holder_view_cache() {
+                trim();
+                if (m_lists)
+                    m_list_alloc.deallocate(m_lists, m_nworkers);
+            }
+
+            /// Cache at most 'views' views, spread evenly over the workers.
+            void set_limit(std::size_t views) {
+                for (unsigned i = 0; i < m_nworkers; ++i) {
+                    m_lists[i].limit = views / m_nworkers +
+                                       (i < views % m_nworkers ? 1 : 0);
+                }
+            }
+
+            void set_reset(void (*reset)(Type&)) { m_reset = reset; }
+
+            /// Destroy and free every cached view.  Returns their number.
+            std::size_t trim() {
+                std::size_t freed = 0;
+                for (unsigned i = 0; i < m_nworkers; ++i) {
+                    while (slot* s = m_lists[i].head) {
+                        m_lists[i].head = s->next;
+                        free_slot(s);
+                        ++freed;
+                    }
+                    m_lists[i].count = 0;
+                }
+                return freed;
+            }
+
+            /// Storage for a view, which may already hold a constructed one.
+            Type* allocate() {
+                worker_list* list = my_list();
+                slot* s = list ? list->head : 0;
+                if (s) {
+                    list->head = s->next;
+                    --list->count;
+                } else {
+                    s = m_slot_alloc.allocate(1);
+                    s->constructed = false;
+                }
+                return s->object();
+            }
+
+            /// Make 'p', returned by allocate(), an identity view.
+            void identity(Type* p, init_base<Type, Allocator>* init,
+                          Allocator& a) {
+                slot* s = slot::of(p);
+                if (!s->constructed) {
+                    init->construct_view(p, a);
+                    s->constructed = true;
+                } else if (m_reset) {
+                    m_reset(*p);
+                }
+            }
+
+            /// Return 'p', returned by allocate(), to the calling worker.
+            void deallocate(Type* p) {
+                slot* s = slot::of(p);
+                worker_list* list = my_list();
+                if (list && s->constructed && list->count < list->limit) {
+                    s->next = list->head;
+                    list->head = s;
+                    ++list->count;
+                } else {
+                    free_slot(s);
+                }
+            }
+        };
+
         /**
          * Functor called to reduce a holder
          */
@@ -757,6 +928,14 @@ namespace cilk {
             }
         };
 
+        /**
+         * Specialization to keep the left (first) value of a persistent
+         * holder.
+         */
+        template <typename Type>
+        struct holder_reduce_functor<Type, holder_keep_persistent>
+            : holder_reduce_functor<Type, holder_keep_indeterminate> { };
+
         /*
          * Specialization to keep the right (last) value via swap.
          */
@@ -830,6 +1009,18 @@ namespace cilk {
         mutable Allocator                     m_allocator;
         internal::init_base<Type, Allocator> *m_initializer;
 
+        // Cache of released views, used only by the persistent policy.
+        typedef internal::holder_view_cache<Type, Allocator> cache_type;
+        cache_type                           *m_cache;
+
+        cache_type* make_cache() const {
+            return Policy == holder_keep_persistent ?
+                new cache_type(m_allocator) : 0;
+        }
+
+        void construct_leftmost(Type* p) const
+            { m_initializer->construct_view(p, m_allocator); }
+
     public:
         /// This constructor uses default-initialization for both the leftmost
         /// view and each identity view.
@@ -837,6 +1028,7 @@ namespace cilk {
             : m_allocator(a)
             , m_initializer(
                 internal::default_init<Type, Allocator>::make(m_allocator))
+            , m_cache(make_cache())
             { }
 
         /// These constructors use 'val' as an exemplar to copy-construct both
@@ -844,7 +1036,8 @@ namespace cilk {
         holder_monoid(const Type& val, const Allocator& a = Allocator())
             : m_allocator(a)
             , m_initializer(internal::exemplar_init<Type, Allocator>::make(
-                                val, m_allocator)) { }
+                                val, m_allocator))
+            , m_cache(make_cache()) { }
         /// This constructor uses 'f' as a functor to construct both
         /// the leftmost view and each identity view.
         template <typename Func>
@@ -852,23 +1045,27 @@ namespace cilk {
             : m_allocator(a)
             , m_initializer(
                 internal::functor_init<Func, Allocator>::make(f,m_allocator))
+            , m_cache(make_cache())
             { }
 
         /// Copy constructor
         holder_monoid(const holder_monoid& rhs)
             : m_allocator(rhs.m_allocator)
-            , m_initializer(rhs.m_initializer->clone_self(m_allocator)) { }
+            , m_initializer(rhs.m_initializer->clone_self(m_allocator))
+            , m_cache(make_cache()) { }
 
         /// "Extended" copy constructor with allocator
         holder_monoid(const holder_monoid& rhs, const Allocator& a)
             : m_allocator(a)
-            , m_initializer(rhs.m_initializer->clone_self(m_allocator)) { }
+            , m_initializer(rhs.m_initializer->clone_self(m_allocator))
+            , m_cache(make_cache()) { }
 
 #ifdef __CILKRTS_RVALUE_REFERENCES
         /// Move constructor
         holder_monoid(holder_monoid&& rhs)
             : m_allocator(rhs.m_allocator)
-            , m_initializer(rhs.m_initializer) {
+            , m_initializer(rhs.m_initializer)
+            , m_cache(make_cache()) {
             rhs.m_initializer =
                 internal::default_init<Type, Allocator>::make(m_allocator);
         }
@@ -876,7 +1073,8 @@ namespace cilk {
         /// "Extended" move constructor with allocator
         holder_monoid(holder_monoid&& rhs, const Allocator& a)
             : m_allocator(a)
-            , m_initializer(0) {
+            , m_initializer(0)
+            , m_cache(make_cache()) {
             if (a != rhs.m_allocator)
                 m_initializer = rhs.m_initializer->clone_self(a);
             else {
@@ -887,7 +1085,10 @@ namespace cilk {
         }
 #endif
         /// Destructor
-        ~holder_monoid() { m_initializer->delete_self(m_allocator); }
+        ~holder_monoid() {
+            delete m_cache;
+            m_initializer->delete_self(m_allocator);
+        }
 
         holder_monoid& operator=(const holder_monoid& rhs) {
             if (this == &rhs) return *this;
@@ -905,24 +1106,85 @@ namespace cilk {
         }
 #endif
 
-        /// Constructs IDENTITY value into the uninitilized '*p'
-        void identity(Type* p) const
-            { m_initializer->construct_view(p, m_allocator); }
+        /// Constructs the monoid and the leftmost view.  The leftmost view
+        /// is part of the reducer, not of the view cache, so it is
+        /// initialized directly rather than through identity().
+        //@{
+        using monoid_base<Type>::construct;
+
+        static void construct(holder_monoid* monoid, Type* view) {
+            provisional_guard<holder_monoid> guard(
+                new((void*) monoid) holder_monoid());
+            monoid->construct_leftmost(view);
+            guard.confirm();
+        }
 
-        /// Calls the destructor on the object pointed-to by 'p'
-        void destroy(Type* p) const
-            { m_allocator.destroy(p); }
+        static void construct(holder_monoid* monoid, Type* view,
+                              const holder_monoid& m) {
+            provisional_guard<holder_monoid> guard(
+                new((void*) monoid) holder_monoid(m));
+            monoid->construct_leftmost(view);
+            guard.confirm();
+        }
+        //@}
+
+        /// Constructs IDENTITY value into the uninitilized '*p'.  A
+        /// persistent holder reuses a cached view if '*p' holds one.
+        void identity(Type* p) const {
+            if (m_cache)
+                m_cache->identity(p, m_initializer, m_allocator);
+            else
+                m_initializer->construct_view(p, m_allocator);
+        }
+
+        /// Calls the destructor on the object pointed-to by 'p'.  The views
+        /// of a persistent holder are destroyed only when evicted from the
+        /// cache.
+        void destroy(Type* p) const {
+            if (!m_cache)
+                m_allocator.destroy(p);
+        }
 
         /// Return a pointer to size bytes of raw memory
         void* allocate(std::size_t s) const {
+            if (m_cache)
+                return m_cache->allocate();
             return m_allocator.allocate(1);
         }
 
         /// Deallocate the raw memory at p
         void deallocate(void* p) const {
-            m_allocator.deallocate(static_cast<Type*>(p), sizeof(Type));
+            if (m_cache)
+                m_cache->deallocate(static_cast<Type*>(p));
+            else
+                m_allocator.deallocate(static_cast<Type*>(p), 1);
+        }
+
+        /// @name View cache of a persistent holder.
+        /// These have no effect unless the policy is
+        /// 'holder_keep_persistent'.  They must not be called while a
+        /// parallel region uses the holder.
+        //@{
+
+        /// Cache at most 'views' released views in total.
+        void set_cache_limit(std::size_t views) const {
+            if (m_cache)
+                m_cache->set_limit(views);
+        }
+
+        /// Call 'reset' on each cached view when it is reused.
+        void set_reset(void (*reset)(Type&)) const {
+            if (m_cache)
+                m_cache->set_reset(reset);
         }
 
+        /// Destroy the cached views, and return their number.
+        std::size_t trim_cache() const {
+            return m_cache ? m_cache->trim() : 0;
+        }
+
+        //@}
+
         void reduce(Type* left, Type* right) const {
             internal::holder_reduce_functor<Type, Policy>()(left, right);
         }
@@ -996,6 +1258,30 @@ namespace cilk {
             // Alas, cannot use an rvalue for 'f' because it is used twice in
             // the same expression for initializing imp.
             : imp(monoid_type(f, alloc), make_value(f)) { }
+
+        /// @name View cache.
+        /// Only holders with the 'holder_keep_persistent' policy cache
+        /// views.  These functions must not be called while a parallel
+        /// region uses the holder.
+        //@{
+
+        /// Bound the number of views kept for reuse, over all workers.
+        /// Views beyond the bound are destroyed when released.  The
+        /// default is no bound.
+        void set_cache_limit(std::size_t views)
+            { this->monoid().set_cache_limit(views); }
+
+        /// Install a function called on a cached view each time it is
+        /// reused, to put it into a known state; null for none.
+        void set_reset(void (*reset)(Type&))
+            { this->monoid().set_reset(reset); }
+
+        /// Destroy all cached views, for example to release their memory
+        /// between parallel regions.  Returns the number destroyed.
+        std::size_t trim_cache()
+            { return this->monoid().trim_cache(); }
+
+        //@}
     };
 
 } // end namespace cilk
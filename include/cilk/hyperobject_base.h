@@ -55,11 +55,69 @@ void *__cilkrts_hyper_lookup_old(__cilkrts_hyperobject_base *key);
 void *__cilkrts_hyper_alloc(__cilkrts_hyperobject_base *key, size_t bytes);
 void __cilkrts_hyper_dealloc(__cilkrts_hyperobject_base *key, void *view);
 
-#if COMM_REDUCER && ! HASH_REDUCER
+/* Inline lookup fast path.
+ *
+ * The structures below mirror the leading fields of the runtime's reducer
+ * map and are part of the ABI.  For each worker thread the runtime publishes
+ * the address of the worker's current map pointer.  The views of a map are
+ * kept in pages of __CILKRTS_HYPER_PAGE_VIEWS entries; a view belongs to the
+ * current strand if its entry names the reducer.  Anything else, including
+ * code running outside a Cilkified region, takes the out-of-line
+ * __cilkrts_hyper_lookup, which creates missing views. */
+#define __CILKRTS_HYPER_ID_VALID 0x80000000U
+#define __CILKRTS_HYPER_PAGE_VIEWS 256U
+
+typedef struct __cilkrts_hyper_view {
+    void *__val;
+    __cilkrts_hyperobject_base *__key;
+} __cilkrts_hyper_view;
+
+typedef struct __cilkrts_hyper_page {
+    __cilkrts_hyper_view *__views;
+    uint32_t __num_views;
+} __cilkrts_hyper_page;
+
+typedef struct __cilkrts_hyper_table {
+    uint32_t __num_pages;
+    unsigned char __merging;
+    __cilkrts_hyper_page *__pages;
+} __cilkrts_hyper_table;
+
+extern __thread void *const *__cilkrts_tls_hyper_table;
+
+/* Like __cilkrts_hyper_lookup, the wrapper returns the same view throughout
+   a strand, so it carries the same hints. */
+#if defined __clang__ && defined __cilk && __cilk >= 300 && PEER_PURE
+__attribute__((strand_pure, strand_malloc))
+#endif
+static inline __attribute__((always_inline)) void *
+__cilkrts_hyper_lookup_inline(__cilkrts_hyperobject_base *key) {
+    void *const *slot = __cilkrts_tls_hyper_table;
+    if (__builtin_expect(slot != NULL, 1)) {
+        const __cilkrts_hyper_table *table =
+            (const __cilkrts_hyper_table *)*slot;
+        uint32_t id = key->__id_num & ~__CILKRTS_HYPER_ID_VALID;
+        uint32_t page = id / __CILKRTS_HYPER_PAGE_VIEWS;
+        if (table && !table->__merging && page < table->__num_pages) {
+            const __cilkrts_hyper_view *views = table->__pages[page].__views;
+            if (views) {
+                const __cilkrts_hyper_view *view =
+                    &views[id % __CILKRTS_HYPER_PAGE_VIEWS];
+                if (__builtin_expect(view->__key == key, 1))
+                    return view->__val;
+            }
+        }
+    }
+    return __cilkrts_hyper_lookup(key);
+}
+
+#if COMM_REDUCER
 
 void __cilkrts_hyper_create_com(__cilkrts_hyperobject_base *key);
 void *__cilkrts_hyper_lookup_com(__cilkrts_hyperobject_base *key);
 void __cilkrts_hyper_merge_com(__cilkrts_hyperobject_base *key);
+void __cilkrts_hyper_merge_com_partial(__cilkrts_hyperobject_base *key);
+void __cilkrts_hyper_destroy_com(__cilkrts_hyperobject_base *key);
 void *__cilkrts_hyper_alloc_com(__cilkrts_hyperobject_base *key, size_t bytes);
 void __cilkrts_hyper_dealloc_com(__cilkrts_hyperobject_base *key, void *view);
 
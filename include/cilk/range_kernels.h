@@ -0,0 +1,149 @@
+#ifndef _CILK_RANGE_KERNELS_H
+#define _CILK_RANGE_KERNELS_H
+
+#ifdef __cplusplus
+
+#include <cstddef>
+#if __cplusplus >= 201103L
+#include <type_traits>
+#endif
+
+namespace cilk {
+
+/** Kernels behind the range updates of the arithmetic and min/max views,
+ *  such as `r->add_range(first, last)`.  Each reduces a whole range into a
+ *  single value, so the view is read and written once.  Ranges given as
+ *  pointers to an arithmetic type use several independent accumulators,
+ *  which lets the compiler vectorize the loop for the target it was asked
+ *  to build for (SSE, AVX2, NEON, ...).  Other ranges are reduced serially.
+ */
+namespace range_internal {
+
+// Accumulators per kernel: a 256-bit vector of 32-bit elements.
+enum { lanes = 8 };
+
+template <typename T> struct plus_op {
+    static T identity() { return T(); }
+    T operator()(const T &a, const T &b) const { return a + b; }
+};
+
+template <typename T> struct times_op {
+    static T identity() { return T(1); }
+    T operator()(const T &a, const T &b) const { return a * b; }
+};
+
+template <typename T> struct and_op {
+    static T identity() { return ~T(); }
+    T operator()(const T &a, const T &b) const { return a & b; }
+};
+
+template <typename T> struct or_op {
+    static T identity() { return T(); }
+    T operator()(const T &a, const T &b) const { return a | b; }
+};
+
+template <typename T> struct xor_op {
+    static T identity() { return T(); }
+    T operator()(const T &a, const T &b) const { return a ^ b; }
+};
+
+/// Return `acc op x0 op x1 ...` for the elements xi of [first, last).
+template <typename Iter, typename T, typename Op>
+T fold(Iter first, Iter last, T acc, Op op) {
+    for (; first != last; ++first)
+        acc = op(acc, *first);
+    return acc;
+}
+
+/// Return the position in [first, last), which must not be empty, of the
+/// element that a serial series of `if (better(best, x)) best = x` keeps.
+template <typename Iter, typename Better>
+std::size_t best_position(Iter first, Iter last, Better better) {
+    std::size_t best = 0, pos = 1;
+    Iter best_it = first;
+    for (++first; first != last; ++first, ++pos) {
+        if (better(*best_it, *first)) {
+            best_it = first;
+            best = pos;
+        }
+    }
+    return best;
+}
+
+#if __cplusplus >= 201103L
+/* Reassociating the operation changes the rounding of floating-point sums
+   and products, as a parallel reduction does. */
+template <typename T, typename Op>
+typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+fold(const T *first, const T *last, T acc, Op op) {
+    std::size_t n = last - first, i = 0;
+    if (n < 2 * lanes)
+        return fold<const T *, T, Op>(first, last, acc, op);
+    T lane[lanes];
+    for (int k = 0; k < lanes; ++k)
+        lane[k] = Op::identity();
+    for (; i + lanes <= n; i += lanes)
+        for (int k = 0; k < lanes; ++k)
+            lane[k] = op(lane[k], first[i + k]);
+    for (int k = 0; k < lanes; ++k)
+        acc = op(acc, lane[k]);
+    for (; i < n; ++i)
+        acc = op(acc, first[i]);
+    return acc;
+}
+
+template <typename T, typename Op>
+typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+fold(T *first, T *last, T acc, Op op) {
+    return fold(static_cast<const T *>(first), static_cast<const T *>(last),
+                acc, op);
+}
+
+/* Each lane keeps the first best element of its own stride.  When better
+   is a strict weak ordering, the first best of the lanes' winners is the
+   element the serial loop keeps. */
+template <typename T, typename Better>
+typename std::enable_if<std::is_arithmetic<T>::value, std::size_t>::type
+best_position(const T *first, const T *last, Better better) {
+    std::size_t n = last - first, i;
+    if (n < 2 * lanes)
+        return best_position<const T *, Better>(first, last, better);
+    T lane[lanes];
+    std::size_t pos[lanes];
+    for (int k = 0; k < lanes; ++k) {
+        lane[k] = first[k];
+        pos[k] = k;
+    }
+    for (i = lanes; i + lanes <= n; i += lanes) {
+        for (int k = 0; k < lanes; ++k) {
+            bool take = better(lane[k], first[i + k]);
+            lane[k] = take ? first[i + k] : lane[k];
+            pos[k] = take ? i + k : pos[k];
+        }
+    }
+    std::size_t best = pos[0];
+    for (int k = 1; k < lanes; ++k)
+        if (better(first[best], lane[k]) ||
+            (!better(lane[k], first[best]) && pos[k] < best))
+            best = pos[k];
+    for (; i < n; ++i)
+        if (better(first[best], first[i]))
+            best = i;
+    return best;
+}
+
+template <typename T, typename Better>
+typename std::enable_if<std::is_arithmetic<T>::value, std::size_t>::type
+best_position(T *first, T *last, Better better) {
+    return best_position(static_cast<const T *>(first),
+                         static_cast<const T *>(last), better);
+}
+#endif
+
+} // namespace range_internal
+
+} // namespace cilk
+
+#endif /* __cplusplus */
+
+#endif /* _CILK_RANGE_KERNELS_H */
@@ -173,6 +173,13 @@ template <typename Type> class provisional_guard {
  *  reducer class that is based on it, and an optional view class which wraps
  *  value objects and restricts access to their operations.
  *
+ *  If the program sets `CILK_MERGE_THRESHOLD`, idle workers help with
+ *  large merges, and the `reduce` function may then be called on a worker
+ *  other than the one running the strands whose views it combines. Such a
+ *  `reduce` must not read or update the view of any reducer or holder,
+ *  which would be the helping worker's view. By default every reduction
+ *  runs on the worker that owns the views.
+ *
  *  @tparam Value   The value type for the monoid.
  *  @tparam View    An optional view class that serves as a proxy for the value
  *                  type.
@@ -878,7 +885,8 @@ template <typename Monoid> class reducer_base {
      *  @return A reference to the per-strand view instance.
      */
     view_type &view() {
-        return *static_cast<view_type *>(__cilkrts_hyper_lookup(&m_base));
+        return *static_cast<view_type *>(
+            __cilkrts_hyper_lookup_inline(&m_base));
     }
 
     /** @copydoc view()
@@ -1390,6 +1398,260 @@ class reducer : public internal::reducer_content<Monoid> {
 using stub::reducer;
 #endif
 
+#if COMM_REDUCER
+
+/** Metafunction marking a monoid as commutative.
+ *
+ *  A monoid may be used with @ref comm_reducer only if its reduce operation
+ *  gives the same result whichever order the views are combined in.
+ *  `is_commutative<Monoid>::%value` is false by default; the headers for the
+ *  addition, bitwise, minimum and maximum reducers specialize it for their
+ *  monoids, and users may specialize it for their own.
+ */
+template <typename Monoid> struct is_commutative {
+    static const bool value = false;
+};
+
+/** Commutative reducer class.
+ *
+ *  A comm_reducer is used like a @ref reducer, but each worker keeps a
+ *  single view of it for the whole computation instead of one view per
+ *  stolen strand. Views are never merged at steals or syncs. They are all
+ *  combined into the reducer's value when the value is read with
+ *  get_value() or move_out(), or explicitly with merge(). This is much
+ *  cheaper for counters and histograms whose updates can be combined in
+ *  any order.
+ *
+ *  The views are allocated on cache lines of their own by the runtime;
+ *  the allocate() and deallocate() functions of the monoid are not used.
+ *
+ *  @warning    The value must not be read, set or merged while strands
+ *              that update the reducer are running.
+ *
+ *  @tparam Monoid  The monoid class that the reducer is instantiated on.
+ *                  @ref is_commutative must be true for it.
+ */
+template <class Monoid> class comm_reducer {
+  public:
+    typedef Monoid monoid_type;                     ///< The monoid type.
+    typedef typename Monoid::value_type value_type; ///< The value type.
+    typedef typename Monoid::view_type view_type;   ///< The view type.
+
+  private:
+    typedef internal::reducer_set_get<value_type, view_type> set_get;
+
+    __CILKRTS_STATIC_ASSERT(is_commutative<Monoid>::value,
+                            "comm_reducer requires a commutative monoid");
+
+    // The hyperobject is registered with the per-worker commutative maps.
+    __cilkrts_hyperobject_base m_base;
+
+    // The monoid and the value accumulated by merge(), constructed by the
+    // monoid_type::construct() function.
+    internal::storage_for_object<Monoid> m_monoid;
+    internal::storage_for_object<view_type> m_value;
+
+    static void reduce_wrapper(void *r, void *lhs, void *rhs) {
+        static_cast<comm_reducer *>(r)->monoid_ptr()->reduce(
+            static_cast<view_type *>(lhs), static_cast<view_type *>(rhs));
+    }
+    static void identity_wrapper(void *r, void *view) {
+        static_cast<comm_reducer *>(r)->monoid_ptr()->identity(
+            static_cast<view_type *>(view));
+    }
+    static void destroy_wrapper(void *r, void *view) {
+        static_cast<comm_reducer *>(r)->monoid_ptr()->destroy(
+            static_cast<view_type *>(view));
+    }
+
+    Monoid *monoid_ptr() { return &m_monoid.object(); }
+    view_type *value_ptr() { return &m_value.object(); }
+
+    void init() {
+        m_base.__c_monoid.reduce_fn = (cilk_reduce_fn_t)&reduce_wrapper;
+        m_base.__c_monoid.identity_fn = (cilk_identity_fn_t)&identity_wrapper;
+        m_base.__c_monoid.destroy_fn = (cilk_destroy_fn_t)&destroy_wrapper;
+        m_base.__c_monoid.allocate_fn = __cilkrts_hyper_alloc_com;
+        m_base.__c_monoid.deallocate_fn = __cilkrts_hyper_dealloc_com;
+        m_base.__id_num = 0;
+        m_base.__view_offset = (char *)value_ptr() - (char *)this;
+        m_base.__view_size = sizeof(view_type);
+        __cilkrts_hyper_create_com(&m_base);
+    }
+
+    comm_reducer(const comm_reducer &);            ///< Disallow copying.
+    comm_reducer &operator=(const comm_reducer &); ///< Disallow assignment.
+
+  public:
+    /** @name Constructors
+     *
+     *  The constructor arguments are passed through to the construct()
+     *  function of the monoid class, as for @ref reducer.
+     */
+    //@{
+
+    comm_reducer() {
+        monoid_type::construct(monoid_ptr(), value_ptr());
+        init();
+    }
+
+    template <typename T1> comm_reducer(const T1 &x1) {
+        monoid_type::construct(monoid_ptr(), value_ptr(), x1);
+        init();
+    }
+
+    template <typename T1, typename T2>
+    comm_reducer(const T1 &x1, const T2 &x2) {
+        monoid_type::construct(monoid_ptr(), value_ptr(), x1, x2);
+        init();
+    }
+
+    template <typename T1, typename T2, typename T3>
+    comm_reducer(const T1 &x1, const T2 &x2, const T3 &x3) {
+        monoid_type::construct(monoid_ptr(), value_ptr(), x1, x2, x3);
+        init();
+    }
+
+    template <typename T1> comm_reducer(T1 &x1) {
+        monoid_type::construct(monoid_ptr(), value_ptr(), x1);
+        init();
+    }
+
+    //@}
+
+    /** Destructor. Frees the views of all workers.
+     */
+    __CILKRTS_STRAND_STALE(~comm_reducer()) {
+        __cilkrts_hyper_destroy_com(&m_base);
+        value_ptr()->~view_type();
+        monoid_ptr()->~monoid_type();
+    }
+
+    //@{
+    /** Get the monoid.
+     */
+    Monoid &monoid() { return *monoid_ptr(); }
+
+    const Monoid &monoid() const {
+        return const_cast<comm_reducer *>(this)->monoid();
+    }
+    //@}
+
+    /** Access the view of the current worker, creating it if necessary.
+     */
+    view_type &view() {
+        return *static_cast<view_type *>(__cilkrts_hyper_lookup_com(&m_base));
+    }
+
+    //@{
+    /** Dereference the reducer to get the view of the current worker.
+     */
+    view_type &operator*() { return view(); }
+    view_type *operator->() { return &view(); }
+    //@}
+
+    /** Combine the views of all workers into the value of the reducer.
+     *
+     *  The views are reset to the identity and stay allocated for the next
+     *  parallel computation. They are combined by the calling thread, so
+     *  no strand that updates the reducer may run concurrently.
+     */
+    void merge() {
+        __cilkrts_hyper_merge_com_partial(&m_base);
+        view_type *merged = &view();
+        monoid_ptr()->reduce(value_ptr(), merged);
+        monoid_ptr()->destroy(merged);
+        monoid_ptr()->identity(merged);
+    }
+
+    /** @name Set and get the value.
+     *
+     *  These functions merge the views of all workers first, so they see
+     *  every update made before they are called.
+     *
+     *  @see reducer::move_in()
+     */
+    //@{
+
+    void move_in(value_type &obj) {
+        merge();
+        set_get::move_in(*value_ptr(), obj);
+    }
+
+    void move_out(value_type &obj) {
+        merge();
+        set_get::move_out(*value_ptr(), obj);
+    }
+
+    void set_value(const value_type &obj) {
+        merge();
+        set_get::set_value(*value_ptr(), obj);
+    }
+
+    typename set_get::return_type_for_get_value get_value() const {
+        comm_reducer *self = const_cast<comm_reducer *>(this);
+        self->merge();
+        return set_get::get_value(*self->value_ptr());
+    }
+
+    //@}
+};
+
+#endif // COMM_REDUCER
+
+/** Handle to the current view of a reducer for a serial region of code.
+ *
+ *  The view of a reducer can change only at a spawn or a sync, so a loop
+ *  that updates a reducer many times between them can look the view up
+ *  once instead of on every iteration:
+ *
+ *      cilk::reducer< cilk::op_add<long> > sum;
+ *      cilk_for (long b = 0; b < blocks; ++b) {
+ *          cilk::view_scope< cilk::reducer< cilk::op_add<long> > > s(sum);
+ *          for (long i = b * block; i < (b + 1) * block; ++i)
+ *              *s += a[i];
+ *      }
+ *
+ *  A view_scope must not be used across a cilk_spawn or cilk_sync, since
+ *  the strand after either one may have a different view. Unless NDEBUG is
+ *  defined, every access through the handle and its destructor assert that
+ *  the view is still the current one.
+ *
+ *  @tparam Reducer A @ref reducer or @ref comm_reducer type.
+ */
+template <class Reducer> class view_scope {
+  public:
+    typedef typename Reducer::view_type view_type; ///< The view type.
+
+  private:
+    Reducer &m_reducer;
+    view_type *const m_view;
+
+    // Not copyable: a copy could escape the region.
+    view_scope(const view_scope &);
+    view_scope &operator=(const view_scope &);
+
+    view_type *checked() const {
+        assert(&m_reducer.view() == m_view &&
+               "view_scope used across a spawn or sync");
+        return m_view;
+    }
+
+  public:
+    /** Look up the view of @a r for the current strand.
+     */
+    explicit view_scope(Reducer &r) : m_reducer(r), m_view(&r.view()) {}
+
+    ~view_scope() { checked(); }
+
+    //@{
+    /** The view that was current when the handle was created.
+     */
+    view_type &operator*() const { return *checked(); }
+    view_type *operator->() const { return checked(); }
+    //@}
+};
+
 } // end namespace cilk
 
 #endif /* __cplusplus */
@@ -1448,6 +1710,11 @@ using stub::reducer;
  *  values, leaving the result in the `left` value. The `right` value is
  *  undefined after the reduce function call.
  *
+ *  If the program sets `CILK_MERGE_THRESHOLD`, idle workers help with large
+ *  merges and the reduce function may be called on a worker other than the
+ *  one running the strands whose values it combines. It must then not use
+ *  `REDUCER_VIEW` or otherwise look up the view of any reducer.
+ *
  *  @subsection reducers_c_identity_func Identity Functions
  *
  *  The identity function for a reducer is called when a parallel execution
@@ -1856,15 +2123,54 @@ using stub::reducer;
  *  @see @ref page_reducers_in_c
  */
 #define REDUCER_VIEW(Expr)                                                     \
-    (*(_Typeof((Expr).value) *)__cilkrts_hyper_lookup(                         \
+    (*(_Typeof((Expr).value) *)__cilkrts_hyper_lookup_inline(                  \
         &(Expr).__cilkrts_hyperbase))
 
 #define REDUCER_VIEW_OLD(Expr)                                                     \
     (*(_Typeof((Expr).value) *)__cilkrts_hyper_lookup_old(                         \
         &(Expr).__cilkrts_hyperbase))
 
+/** Declare a pointer to the current view of a reducer for the rest of the
+ *  enclosing block.
+ *
+ *  The view of a reducer can change only at a spawn or a sync, so a loop
+ *  with neither can look the view up once instead of on every iteration:
+ *
+ *      CILK_C_VIEW_SCOPE(my_add_int_reducer, sum);
+ *      for (i = 0; i < n; ++i)
+ *          *sum += a[i];
+ *
+ *  The block must not contain a cilk_spawn or cilk_sync after the
+ *  declaration. Unless NDEBUG is defined, compilers that support the
+ *  cleanup attribute assert when the block is left that the view is still
+ *  the current one.
+ *
+ *  @param Expr The reducer.
+ *  @param Name The name of the pointer variable to declare.
+ */
+#if !defined(NDEBUG) && defined(__GNUC__)
+typedef struct {
+    __cilkrts_hyperobject_base *key;
+    void *view;
+} __cilkrts_view_scope;
+
+static inline void __cilkrts_view_scope_check(__cilkrts_view_scope *scope) {
+    assert(__cilkrts_hyper_lookup_inline(scope->key) == scope->view &&
+           "CILK_C_VIEW_SCOPE used across a spawn or sync");
+}
+
+#define CILK_C_VIEW_SCOPE(Expr, Name)                                          \
+    _Typeof((Expr).value) *const Name = &REDUCER_VIEW(Expr);                   \
+    __cilkrts_view_scope __CILKRTS_MKIDENT(__cilkrts_view_scope_, Name)        \
+        __attribute__((cleanup(__cilkrts_view_scope_check))) = {               \
+            &(Expr).__cilkrts_hyperbase, Name}
+#else
+#define CILK_C_VIEW_SCOPE(Expr, Name)                                          \
+    _Typeof((Expr).value) *const Name = &REDUCER_VIEW(Expr)
+#endif
+
 
-#if COMM_REDUCER && ! HASH_REDUCER
+#if COMM_REDUCER
 
 #define CILK_C_INIT_COM_REDUCER(Type, Reduce, Identity, Destroy)               \
     {                                                                          \
@@ -1878,13 +2184,25 @@ using stub::reducer;
 #define CILK_C_REGISTER_COM_REDUCER(Expr)                                      \
     __cilkrts_hyper_create_com(&(Expr).__cilkrts_hyperbase)
 
+#define CILK_C_UNREGISTER_COM_REDUCER(Expr)                                    \
+    __cilkrts_hyper_destroy_com(&(Expr).__cilkrts_hyperbase)
+
 #define COM_REDUCER_VIEW(Expr)                                                 \
     (*(_Typeof((Expr).value) *)__cilkrts_hyper_lookup_com(                     \
         &(Expr).__cilkrts_hyperbase))
 
+/* Reduce every worker's view of a commutative reducer into the caller's.
+   The views are combined on the calling thread; no strand that updates the
+   reducer may run concurrently. */
 #define COM_REDUCER_MERGE(Expr) \
     __cilkrts_hyper_merge_com(&(Expr).__cilkrts_hyperbase)
 
+/* Like COM_REDUCER_MERGE, but the other workers keep their views, reset to
+   the identity, for use in the next parallel region.  They are freed by the
+   next COM_REDUCER_MERGE. */
+#define COM_REDUCER_MERGE_PARTIAL(Expr) \
+    __cilkrts_hyper_merge_com_partial(&(Expr).__cilkrts_hyperbase)
+
 #endif
 
 //@} C language reducer macros
@@ -0,0 +1,447 @@
+/** @file reducer_array.h
+ *
+ *  @brief Defines classes for element-wise addition into arrays, such as
+ *  histograms.
+ *
+ *  A `cilk::reducer< cilk::op_array_add<Type, N> >` holds an array of @a N
+ *  counters; `cilk::reducer< cilk::op_array_add<Type> >` holds a number of
+ *  counters given to its constructor. Strands add to individual elements
+ *  and the views are added element-wise when strands merge:
+ *
+ *      cilk::reducer< cilk::op_array_add<long, 256> > hist;
+ *      cilk_for (int i = 0; i < n; ++i)
+ *          hist->add(bin(a[i]));
+ *      const std::array<long, 256> &counts = hist.get_value();
+ *
+ *  Views are cache-line aligned and are zeroed lazily, one block of
+ *  elements at a time, so a steal that touches a few bins costs a few
+ *  blocks rather than a pass over the whole array. The reduction skips
+ *  blocks that the right view never touched, and adds the others with a
+ *  loop the compiler can vectorize.
+ *
+ *  @ingroup ReducersArray
+ */
+
+#ifndef REDUCER_ARRAY_H_INCLUDED
+#define REDUCER_ARRAY_H_INCLUDED
+
+#include <cilk/reducer.h>
+
+#ifdef __cplusplus
+
+#if __cplusplus < 201103L
+#error "reducer_array.h requires C++11"
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace cilk {
+
+namespace array_internal {
+
+enum {
+    cache_line = 64,
+    block_bytes = 512 ///< Views are zeroed and merged in blocks of this size.
+};
+
+/** Block layout of an array of @a Type. */
+template <typename Type> struct layout {
+    enum {
+        block = block_bytes / sizeof(Type) ? block_bytes / sizeof(Type) : 1,
+        // Whether every block starts on a cache line of an aligned array.
+        aligned_blocks = block * sizeof(Type) % cache_line == 0
+    };
+    static constexpr std::size_t blocks(std::size_t n) {
+        return (n + block - 1) / block;
+    }
+    static constexpr std::size_t words(std::size_t n) {
+        return (blocks(n) + 63) / 64;
+    }
+};
+
+inline void *aligned_allocate(std::size_t s) {
+    void *p;
+    if (posix_memalign(&p, cache_line, s ? s : std::size_t(cache_line)))
+        throw std::bad_alloc();
+    return p;
+}
+
+inline void aligned_deallocate(void *p) { std::free(p); }
+
+/** Allocator of cache-aligned memory whose default construction leaves
+ *  trivial elements uninitialized, for the lazily zeroed views. */
+template <typename Type> struct cache_aligned_allocator {
+    typedef Type value_type;
+
+    cache_aligned_allocator() {}
+    template <typename U>
+    cache_aligned_allocator(const cache_aligned_allocator<U> &) {}
+
+    Type *allocate(std::size_t n) {
+        return static_cast<Type *>(aligned_allocate(n * sizeof(Type)));
+    }
+    void deallocate(Type *p, std::size_t) { aligned_deallocate(p); }
+
+    template <typename U> void construct(U *p) { ::new ((void *)p) U; }
+    template <typename U, typename... Args>
+    void construct(U *p, Args &&...args) {
+        ::new ((void *)p) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U> struct rebind {
+        typedef cache_aligned_allocator<U> other;
+    };
+};
+
+template <typename T, typename U>
+inline bool operator==(const cache_aligned_allocator<T> &,
+                       const cache_aligned_allocator<U> &) {
+    return true;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const cache_aligned_allocator<T> &,
+                       const cache_aligned_allocator<U> &) {
+    return false;
+}
+
+/** Element-wise `left[i] += right[i]` for one block.  The arrays do not
+ *  overlap, and are cache-aligned if the layout allows it, so that the
+ *  compiler emits aligned vector adds without a scalar prologue. */
+template <typename Type>
+inline void add_block(Type *__restrict__ left, const Type *__restrict__ right,
+                      std::size_t n) {
+    if (layout<Type>::aligned_blocks) {
+        left = static_cast<Type *>(__builtin_assume_aligned(left, cache_line));
+        right = static_cast<const Type *>(
+            __builtin_assume_aligned(right, cache_line));
+    }
+    for (std::size_t i = 0; i < n; ++i)
+        left[i] += right[i];
+}
+
+/** Storage of a view: @a n elements and one bit per block telling whether
+ *  the block has been zeroed. */
+template <typename Type> struct blocks_ref {
+    Type *data;
+    std::uint64_t *init;
+    std::size_t n;
+
+    typedef layout<Type> L;
+
+    std::size_t block_begin(std::size_t b) const { return b * L::block; }
+    std::size_t block_end(std::size_t b) const {
+        return std::min<std::size_t>((b + 1) * L::block, n);
+    }
+    bool has(std::size_t b) const { return init[b / 64] >> (b % 64) & 1; }
+
+    void zero(std::size_t b) const {
+        std::fill(data + block_begin(b), data + block_end(b), Type());
+        init[b / 64] |= std::uint64_t(1) << (b % 64);
+    }
+
+    /// Zero every block not yet zeroed.
+    void materialize() const {
+        for (std::size_t b = 0; b < L::blocks(n); ++b)
+            if (!has(b))
+                zero(b);
+    }
+
+    void forget() const { std::fill(init, init + L::words(n), 0); }
+    void mark_all() const {
+        forget();
+        for (std::size_t b = 0; b < L::blocks(n); ++b)
+            init[b / 64] |= std::uint64_t(1) << (b % 64);
+    }
+
+    /// Add right into this array, visiting only the blocks right touched.
+    void add(const blocks_ref &right) const {
+        for (std::size_t w = 0; w < L::words(n); ++w) {
+            std::uint64_t bits = right.init[w];
+            while (bits) {
+                std::size_t b = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                std::size_t begin = block_begin(b);
+                if (has(b)) {
+                    add_block(data + begin, right.data + begin,
+                              block_end(b) - begin);
+                } else {
+                    std::copy(right.data + begin, right.data + block_end(b),
+                              data + begin);
+                    init[w] |= std::uint64_t(1) << (b % 64);
+                }
+            }
+        }
+    }
+};
+
+} // namespace array_internal
+
+/** @defgroup ReducersArray Array Reducers
+ *
+ *  Array reducers add into the elements of a fixed-size array.
+ *
+ *  @ingroup Reducers
+ */
+//@{
+
+/** The array addition view class.
+ *
+ *  The view allows only additions to individual elements, through
+ *  `add(i, x)` or `add(i)` (which adds one).
+ *
+ *  @tparam Type    The element type.
+ *  @tparam N       The number of elements, or 0 for the runtime-sized
+ *                  variant.
+ */
+template <typename Type, std::size_t N> class op_array_add_view {
+    typedef array_internal::layout<Type> layout;
+    typedef array_internal::blocks_ref<Type> blocks;
+
+    mutable std::array<Type, N> m_data __attribute__((aligned(64)));
+    mutable std::uint64_t m_init[layout::words(N) ? layout::words(N) : 1];
+
+    blocks ref() const { return blocks{m_data.data(), m_init, N}; }
+
+  public:
+    /// Required by cilk::monoid_with_view
+    typedef std::array<Type, N> value_type;
+
+    /** Identity constructor. The elements are zeroed on first use. */
+    op_array_add_view() { ref().forget(); }
+
+    /** Construct with initial element values. */
+    explicit op_array_add_view(const value_type &v) : m_data(v) {
+        ref().mark_all();
+    }
+
+    /** Reduces the views of two strands. */
+    void reduce(op_array_add_view *right) { ref().add(right->ref()); }
+
+    /** @name Reducer support. */
+    //@{
+
+    void view_move_in(value_type &v) { view_set_value(v); }
+    void view_move_out(value_type &v) {
+        ref().materialize();
+        v = m_data;
+    }
+    void view_set_value(const value_type &v) {
+        m_data = v;
+        ref().mark_all();
+    }
+    const value_type &view_get_value() const {
+        ref().materialize();
+        return m_data;
+    }
+    typedef const value_type &return_type_for_get_value;
+
+    //@}
+
+    /** @name View modifier operations. */
+    //@{
+
+    /// Add @a x to element @a i.
+    void add(std::size_t i, const Type &x) {
+        std::size_t b = i / layout::block;
+        if (__builtin_expect(!ref().has(b), 0))
+            ref().zero(b);
+        m_data[i] += x;
+    }
+
+    /// Add one to element @a i.
+    void add(std::size_t i) { add(i, Type(1)); }
+
+    //@}
+
+    static constexpr std::size_t size() { return N; }
+};
+
+/** Runtime-sized array addition view, whose value is a vector. The number
+ *  of elements is fixed when the view is constructed, since identity views
+ *  take it from the monoid; a value of another size is rejected. */
+template <typename Type> class op_array_add_view<Type, 0> {
+    typedef array_internal::layout<Type> layout;
+    typedef array_internal::blocks_ref<Type> blocks;
+
+  public:
+    /// Required by cilk::monoid_with_view
+    typedef std::vector<Type, array_internal::cache_aligned_allocator<Type>>
+        value_type;
+
+  private:
+    mutable value_type m_data;
+    mutable std::vector<std::uint64_t> m_init;
+
+    blocks ref() const { return blocks{m_data.data(), &m_init[0], size()}; }
+
+    void check_size(const value_type &v) const {
+        if (v.size() != size())
+            throw std::length_error(
+                "op_array_add: value size differs from the reducer's");
+    }
+
+  public:
+    /** Identity constructor for an array of @a n elements. The elements are
+     *  zeroed on first use. */
+    explicit op_array_add_view(std::size_t n = 0)
+        : m_data(n), m_init(layout::words(n) ? layout::words(n) : 1) {}
+
+    /** Construct with initial element values. */
+    explicit op_array_add_view(const value_type &v)
+        : m_data(v), m_init(layout::words(v.size()) ? layout::words(v.size())
+                                                    : 1) {
+        ref().mark_all();
+    }
+
+    /** Reduces the views of two strands. */
+    void reduce(op_array_add_view *right) {
+        assert(right->size() == size());
+        bool empty = true;
+        for (std::size_t w = 0; w < m_init.size(); ++w)
+            empty = empty && !m_init[w];
+        if (empty) {
+            // Nothing to add to: take over the right view's array.
+            m_data.swap(right->m_data);
+            m_init.swap(right->m_init);
+        } else {
+            ref().add(right->ref());
+        }
+    }
+
+    /** @name Reducer support. */
+    //@{
+
+    void view_move_in(value_type &v) {
+        check_size(v);
+        m_data.swap(v);
+        ref().mark_all();
+    }
+    /// Leaves an identity view of the same size.
+    void view_move_out(value_type &v) {
+        ref().materialize();
+        m_data.swap(v);
+        value_type(v.size()).swap(m_data);
+        ref().forget();
+    }
+    void view_set_value(const value_type &v) {
+        check_size(v);
+        m_data = v;
+        ref().mark_all();
+    }
+    const value_type &view_get_value() const {
+        ref().materialize();
+        return m_data;
+    }
+    typedef const value_type &return_type_for_get_value;
+
+    //@}
+
+    /** @name View modifier operations. */
+    //@{
+
+    /// Add @a x to element @a i.
+    void add(std::size_t i, const Type &x) {
+        std::size_t b = i / layout::block;
+        if (__builtin_expect(!(m_init[b / 64] >> (b % 64) & 1), 0))
+            ref().zero(b);
+        m_data[i] += x;
+    }
+
+    /// Add one to element @a i.
+    void add(std::size_t i) { add(i, Type(1)); }
+
+    //@}
+
+    std::size_t size() const { return m_data.size(); }
+};
+
+/** Monoid class for element-wise array addition.
+ *
+ *  @tparam Type    The element type.
+ *  @tparam N       The number of elements, or 0 to give the number of
+ *                  elements to the reducer constructor:
+ *
+ *      cilk::reducer< cilk::op_array_add<long> > hist(nbins);
+ *
+ *                  The size cannot change afterwards: `set_value` and
+ *                  `move_in` throw std::length_error for a vector of
+ *                  another size.
+ *
+ *  @tparam Align   If true, the reducer itself is cache-aligned.
+ */
+template <typename Type, std::size_t N = 0, bool Align = false>
+class op_array_add
+    : public monoid_with_view<op_array_add_view<Type, N>, Align> {
+  public:
+    /** Views are allocated on cache-line boundaries. */
+    void *allocate(std::size_t s) const {
+        return array_internal::aligned_allocate(s);
+    }
+    void deallocate(void *p) const { array_internal::aligned_deallocate(p); }
+};
+
+/** Runtime-sized array addition monoid. It remembers the number of
+ *  elements so that identity views have the same size as the leftmost.
+ */
+template <typename Type, bool Align>
+class op_array_add<Type, 0, Align>
+    : public monoid_with_view<op_array_add_view<Type, 0>, Align> {
+    typedef monoid_with_view<op_array_add_view<Type, 0>, Align> base;
+    typedef provisional_guard<typename base::view_type> view_guard;
+
+    std::size_t m_size;
+
+  public:
+    typedef typename base::view_type view_type;
+
+    explicit op_array_add(std::size_t n = 0) : m_size(n) {}
+
+    void identity(view_type *v) const { ::new ((void *)v) view_type(m_size); }
+
+    void *allocate(std::size_t s) const {
+        return array_internal::aligned_allocate(s);
+    }
+    void deallocate(void *p) const { array_internal::aligned_deallocate(p); }
+
+    /** @name construct functions
+     *
+     *  Construct the leftmost view, then a monoid that remembers its size.
+     */
+    //@{
+
+    static void construct(op_array_add *monoid, view_type *view) {
+        view_guard vg(new ((void *)view) view_type());
+        vg.confirm_if(new ((void *)monoid) op_array_add(0));
+    }
+
+    static void construct(op_array_add *monoid, view_type *view,
+                          std::size_t n) {
+        view_guard vg(new ((void *)view) view_type(n));
+        vg.confirm_if(new ((void *)monoid) op_array_add(n));
+    }
+
+    static void construct(op_array_add *monoid, view_type *view,
+                          const typename view_type::value_type &v) {
+        view_guard vg(new ((void *)view) view_type(v));
+        vg.confirm_if(new ((void *)monoid) op_array_add(v.size()));
+    }
+
+    //@}
+};
+
+//@}
+
+} // namespace cilk
+
+#endif // __cplusplus
+
+#endif // REDUCER_ARRAY_H_INCLUDED
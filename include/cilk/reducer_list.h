@@ -59,6 +59,7 @@
 #define REDUCER_LIST_H_INCLUDED
 
 #include <cilk/reducer.h>
+#include <cilk/worker_allocator.h>
 #include <list>
 
 /** @defgroup ReducersList List Reducers
@@ -221,6 +222,23 @@
  *  `std::allocator`) are "the same". You only need to worry about the "same
  *  allocator" issue when you create list reducers with custom allocator types.)
  *
+ *  @subsection redlist_allocator Worker-Local Allocation
+ *
+ *  Strands that push elements in parallel allocate list nodes from the
+ *  global heap. Specifying `cilk::worker_allocator<Type>` as the allocator
+ *  takes the nodes from the free lists of the worker running the strand
+ *  instead, so the strands do not contend for a lock. A node freed on
+ *  another worker, as when the final list is destroyed, is returned to the
+ *  worker that allocated it. `worker_allocator` has no state, so views can
+ *  still be spliced in constant time:
+ *
+ *      std::list<Element, worker_allocator<Element> > a_list;
+ *      reducer< op_list_append<Element, worker_allocator<Element> > >
+ *          r(move_in(a_list));
+ *
+ *  Such a list must not be modified by a thread that is not running Cilk
+ *  code while a Cilkified region is running; see `__cilkrts_worker_malloc`.
+ *
  *  @section redlist_types Type and Operator Requirements
  *
  *  `std::list<Type, Allocator>` must be a valid type.
@@ -0,0 +1,349 @@
+/** @file reducer_map.h
+ *
+ *  @brief Defines classes for building a hash map in parallel, merging the
+ *  values of equal keys.
+ *
+ *  A `cilk::reducer< cilk::op_map_merge<Key, Value, Merge> >` holds an
+ *  open-addressing hash map. Strands insert with `r->merge(key, value)`;
+ *  if the key is already present, its value becomes
+ *  `merge(old_value, value)`. When strands merge, the smaller map is merged
+ *  into the larger one, again with `merge(left_value, right_value)`, so the
+ *  result is the same as a serial execution as long as @a Merge is
+ *  associative. For example, to count words:
+ *
+ *      cilk::reducer< cilk::op_map_merge<std::string, long> > counts;
+ *      cilk_for (std::size_t i = 0; i < words.size(); ++i)
+ *          counts->merge(words[i], 1);
+ *      for (auto &kv : counts.get_value())
+ *          printf("%s %ld\n", kv.first.c_str(), kv.second);
+ *
+ *  Merging two maps is serial and takes time proportional to the capacity
+ *  of the smaller one. Reduce operations run in runtime callbacks that
+ *  cannot spawn, so even the merge of two large maps is not parallelized.
+ *
+ *  @ingroup ReducersMap
+ */
+
+#ifndef REDUCER_MAP_H_INCLUDED
+#define REDUCER_MAP_H_INCLUDED
+
+#include <cilk/reducer.h>
+
+#ifdef __cplusplus
+
+#if __cplusplus < 201103L
+#error "reducer_map.h requires C++11"
+#endif
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace cilk {
+
+/** Open-addressing hash map with linear probing, the value of an
+ *  op_map_merge reducer. Entries are never erased individually.
+ *
+ *  @tparam Key         The key type; it must be default constructible.
+ *  @tparam Value       The mapped type; it must be default constructible.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class open_hash_map {
+  public:
+    typedef Key key_type;
+    typedef Value mapped_type;
+    typedef std::pair<Key, Value> value_type;
+    typedef std::size_t size_type;
+
+  private:
+    // m_tags[i] is 0 for an empty slot, and otherwise the mixed hash of the
+    // key in m_slots[i] with the top bit set.
+    std::vector<std::size_t> m_tags;
+    std::vector<value_type> m_slots;
+    size_type m_size;
+    Hash m_hash;
+    KeyEqual m_equal;
+
+    static const std::size_t top_bit = ~(~std::size_t(0) >> 1);
+
+    std::size_t tag_of(const Key &key) const {
+        unsigned long long h = m_hash(key);
+        h *= 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+        return std::size_t(h) | top_bit;
+    }
+
+    size_type capacity() const { return m_tags.size(); }
+
+    // Keep the load factor at most 7/10.
+    static bool fits(size_type n, size_type cap) { return n * 10 <= cap * 7; }
+
+    // The slot holding key, or the empty slot where it belongs.
+    size_type probe(const Key &key, std::size_t tag) const {
+        size_type mask = capacity() - 1;
+        size_type i = tag & mask;
+        while (m_tags[i]) {
+            if (m_tags[i] == tag && m_equal(m_slots[i].first, key))
+                return i;
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void place(std::size_t tag, value_type &&entry) {
+        size_type i = probe(entry.first, tag);
+        m_tags[i] = tag;
+        m_slots[i] = std::move(entry);
+        ++m_size;
+    }
+
+    void rehash(size_type cap) {
+        std::vector<std::size_t> tags(cap, 0);
+        std::vector<value_type> slots(cap);
+        tags.swap(m_tags);
+        slots.swap(m_slots);
+        m_size = 0;
+        for (size_type i = 0; i < tags.size(); ++i)
+            if (tags[i])
+                place(tags[i], std::move(slots[i]));
+    }
+
+    template <typename Merge>
+    static void combine(Merge &merge, Value &into, Value &&from,
+                        bool from_left) {
+        into = from_left ? merge(std::move(from), std::move(into))
+                         : merge(std::move(into), std::move(from));
+    }
+
+    /* Merge the entries of small, which holds the left operand if
+       small_left is set, into this map.  There is room for all of them.
+       This runs in a reduce callback, which cannot spawn, so it is
+       serial. */
+    template <typename Merge>
+    void absorb(open_hash_map &small, Merge &merge, bool small_left) {
+        size_type n = small.capacity();
+        for (size_type i = 0; i < n; ++i) {
+            std::size_t tag = small.m_tags[i];
+            if (!tag)
+                continue;
+            size_type j = probe(small.m_slots[i].first, tag);
+            if (m_tags[j]) {
+                combine(merge, m_slots[j].second,
+                        std::move(small.m_slots[i].second), small_left);
+            } else {
+                m_tags[j] = tag;
+                m_slots[j] = std::move(small.m_slots[i]);
+                ++m_size;
+            }
+        }
+    }
+
+  public:
+    /** Iterator over the entries, in no particular order. */
+    class const_iterator {
+        const open_hash_map *m_map;
+        size_type m_index;
+
+        void skip() {
+            while (m_index < m_map->capacity() && !m_map->m_tags[m_index])
+                ++m_index;
+        }
+
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef open_hash_map::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const value_type *pointer;
+        typedef const value_type &reference;
+
+        const_iterator() : m_map(0), m_index(0) {}
+        const_iterator(const open_hash_map *map, size_type index)
+            : m_map(map), m_index(index) {
+            skip();
+        }
+
+        reference operator*() const { return m_map->m_slots[m_index]; }
+        pointer operator->() const { return &m_map->m_slots[m_index]; }
+        const_iterator &operator++() {
+            ++m_index;
+            skip();
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+        bool operator==(const const_iterator &other) const {
+            return m_index == other.m_index;
+        }
+        bool operator!=(const const_iterator &other) const {
+            return m_index != other.m_index;
+        }
+    };
+
+    open_hash_map() : m_size(0) {}
+
+    size_type size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, capacity()); }
+
+    /// Return the value for key, or null if it is absent.
+    const Value *find(const Key &key) const {
+        if (!m_size)
+            return 0;
+        size_type i = probe(key, tag_of(key));
+        return m_tags[i] ? &m_slots[i].second : 0;
+    }
+
+    size_type count(const Key &key) const { return find(key) ? 1 : 0; }
+
+    /// Make room for n entries in all.
+    void reserve(size_type n) {
+        if (fits(n, capacity()))
+            return;
+        size_type cap = capacity() ? capacity() : 16;
+        while (!fits(n, cap))
+            cap *= 2;
+        rehash(cap);
+    }
+
+    /// Insert (key, value), or merge value into the value already present.
+    template <typename Merge, typename K, typename V>
+    void merge(K &&key, V &&value, Merge &merge) {
+        reserve(m_size + 1);
+        std::size_t tag = tag_of(key);
+        size_type i = probe(key, tag);
+        if (m_tags[i]) {
+            m_slots[i].second = merge(std::move(m_slots[i].second),
+                                      std::forward<V>(value));
+        } else {
+            m_tags[i] = tag;
+            m_slots[i].first = std::forward<K>(key);
+            m_slots[i].second = std::forward<V>(value);
+            ++m_size;
+        }
+    }
+
+    /** Merge right, the map of a strand to the right of this one's, into
+     *  this map, leaving right empty. The smaller map is merged into the
+     *  larger one. */
+    template <typename Merge>
+    void merge_right(open_hash_map &right, Merge &merge) {
+        bool small_left = right.size() > size();
+        if (small_left)
+            swap(right);
+        if (right.empty())
+            return;
+        reserve(size() + right.size());
+        absorb(right, merge, small_left);
+        right.clear();
+    }
+
+    void clear() {
+        std::vector<std::size_t>().swap(m_tags);
+        std::vector<value_type>().swap(m_slots);
+        m_size = 0;
+    }
+
+    void swap(open_hash_map &other) {
+        m_tags.swap(other.m_tags);
+        m_slots.swap(other.m_slots);
+        std::swap(m_size, other.m_size);
+        std::swap(m_hash, other.m_hash);
+        std::swap(m_equal, other.m_equal);
+    }
+};
+
+/** @defgroup ReducersMap Hash Map Reducers
+ *
+ *  Hash map reducers build a map in parallel, merging the values of
+ *  equal keys.
+ *
+ *  @ingroup Reducers
+ */
+//@{
+
+/** The map merge view class.
+ *
+ *  The only operation on the view is `merge(key, value)`.
+ */
+template <typename Key, typename Value, typename Merge, typename Hash,
+          typename KeyEqual>
+class op_map_merge_view {
+  public:
+    /// Required by cilk::monoid_with_view
+    typedef open_hash_map<Key, Value, Hash, KeyEqual> value_type;
+
+  private:
+    value_type m_map;
+    Merge m_merge;
+
+  public:
+    /** Identity constructor. */
+    op_map_merge_view() {}
+
+    /** Construct with an initial map. */
+    explicit op_map_merge_view(const value_type &map) : m_map(map) {}
+
+    /** Reduces the views of two strands. */
+    void reduce(op_map_merge_view *right) {
+        m_map.merge_right(right->m_map, m_merge);
+    }
+
+    /** @name Reducer support. */
+    //@{
+
+    void view_move_in(value_type &v) {
+        m_map.clear();
+        m_map.swap(v);
+    }
+    void view_move_out(value_type &v) {
+        v.clear();
+        v.swap(m_map);
+    }
+    void view_set_value(const value_type &v) { m_map = v; }
+    const value_type &view_get_value() const { return m_map; }
+    typedef const value_type &return_type_for_get_value;
+
+    //@}
+
+    /** Insert (key, value), or merge value into the value for key. */
+    template <typename K, typename V> void merge(K &&key, V &&value) {
+        m_map.merge(std::forward<K>(key), std::forward<V>(value), m_merge);
+    }
+
+    /** Make room for n keys, to avoid rehashing as they are inserted. */
+    void reserve(std::size_t n) { m_map.reserve(n); }
+};
+
+/** Monoid class for hash map reductions.
+ *
+ *  @tparam Key         The key type.
+ *  @tparam Value       The mapped type.
+ *  @tparam Merge       A default-constructible associative binary functor
+ *                      on @a Value; the values of a key are combined with
+ *                      `merge(left, right)`.
+ *  @tparam Hash        The hash functor for @a Key.
+ *  @tparam KeyEqual    The equality predicate for @a Key.
+ *  @tparam Align       If true, the reducer itself is cache-aligned.
+ */
+template <typename Key, typename Value, typename Merge = std::plus<Value>,
+          typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, bool Align = false>
+struct op_map_merge
+    : public monoid_with_view<
+          op_map_merge_view<Key, Value, Merge, Hash, KeyEqual>, Align> {};
+
+//@}
+
+} // namespace cilk
+
+#endif // __cplusplus
+
+#endif // REDUCER_MAP_H_INCLUDED
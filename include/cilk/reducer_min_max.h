@@ -62,6 +62,8 @@
 #ifdef __cplusplus
 
 #include <algorithm>
+#include <cilk/range_kernels.h>
+#include <iterator>
 #include <limits>
 
 /** @defgroup ReducersMinMax Minimum and Maximum Reducers
@@ -1281,6 +1283,28 @@ class view_base :
     template <typename View> void assign(const rhs_proxy<View> &rhs) {
         calc(rhs.value(this));
     }
+
+    /** Returns the position in [first, last), which must not be empty, of
+     *  the element that a series of calc() calls would keep. Calling calc()
+     *  with just that element has the same effect as the series.
+     */
+    template <typename Iter>
+    std::size_t range_best(Iter first, Iter last) const {
+        return range_internal::best_position(first, last, range_compare(this));
+    }
+
+  private:
+    /* The comparator as a functor, for the range kernels. */
+    class range_compare {
+        const view_base *m_view;
+
+      public:
+        explicit range_compare(const view_base *view) : m_view(view) {}
+        bool operator()(const typename Content::comp_value_type &a,
+                        const typename Content::comp_value_type &b) const {
+            return m_view->compare(a, b);
+        }
+    };
 };
 
 /** Base class for min and max monoid classes.
@@ -1470,6 +1494,23 @@ class op_max_view : public min_max_internal::view_base<
         return *this;
     }
 
+    /** Maximizes with the elements of [@a first, @a last).
+     *
+     *  Equivalent to calling `calc_max()` on each element in turn, but
+     *  looks up the view once, and scans a range given by pointers to an
+     *  arithmetic type with vectorized code.
+     *
+     *  @return     A reference to the view.
+     */
+    template <typename Iter>
+    op_max_view &calc_max_range(Iter first, Iter last) {
+        if (first != last) {
+            std::advance(first, this->range_best(first, last));
+            calc(*first);
+        }
+        return *this;
+    }
+
     /** Assigns the result of a `max_of(view, value)` expression to the view.
      *
      *  @param  rhs An rhs_proxy value created by a `max_of(view, value)`
@@ -1648,6 +1689,23 @@ class op_min_view
         return *this;
     }
 
+    /** Minimizes with the elements of [@a first, @a last).
+     *
+     *  Equivalent to calling `calc_min()` on each element in turn, but
+     *  looks up the view once, and scans a range given by pointers to an
+     *  arithmetic type with vectorized code.
+     *
+     *  @return     A reference to the view.
+     */
+    template <typename Iter>
+    op_min_view &calc_min_range(Iter first, Iter last) {
+        if (first != last) {
+            std::advance(first, this->range_best(first, last));
+            calc(*first);
+        }
+        return *this;
+    }
+
     /** Assigns the result of a `min_of(view, value)` expression to the view.
      *
      *  @param  rhs An rhs_proxy value created by a `min_of(view, value)`
@@ -1876,6 +1934,26 @@ class op_max_index_view
         return *this;
     }
 
+    /** Maximizes with the elements of [@a first, @a last), where the
+     *  element at position `k` has index `index + k`.
+     *
+     *  Equivalent to calling `calc_max(index + k, first[k])` for each `k` in
+     *  turn, but looks up the view once, and scans a range given by pointers
+     *  to an arithmetic type with vectorized code.
+     *
+     *  @return     A reference to the view.
+     */
+    template <typename Iter>
+    op_max_index_view &calc_max_range(Iter first, Iter last,
+                                      const Index &index) {
+        if (first != last) {
+            std::size_t k = this->range_best(first, last);
+            std::advance(first, k);
+            calc(pair_type(Index(index + k), *first));
+        }
+        return *this;
+    }
+
     /** Assigns the result of a `max_of(view, index, value)` expression to the
      *  view.
      *
@@ -2157,6 +2235,26 @@ class op_min_index_view
         return *this;
     }
 
+    /** Minimizes with the elements of [@a first, @a last), where the
+     *  element at position `k` has index `index + k`.
+     *
+     *  Equivalent to calling `calc_min(index + k, first[k])` for each `k` in
+     *  turn, but looks up the view once, and scans a range given by pointers
+     *  to an arithmetic type with vectorized code.
+     *
+     *  @return     A reference to the view.
+     */
+    template <typename Iter>
+    op_min_index_view &calc_min_range(Iter first, Iter last,
+                                      const Index &index) {
+        if (first != last) {
+            std::size_t k = this->range_best(first, last);
+            std::advance(first, k);
+            calc(pair_type(Index(index + k), *first));
+        }
+        return *this;
+    }
+
     /** Assigns the result of a `min_of(view, index, value)` expression to the
      *  view.
      *
@@ -2400,6 +2498,13 @@ class reducer_max : public reducer<op_max<Type, Compare, true>> {
         return *this;
     }
 
+    /// @copydoc op_max_view::calc_max_range(Iter, Iter)
+    template <typename Iter>
+    reducer_max &calc_max_range(Iter first, Iter last) {
+        view().calc_max_range(first, last);
+        return *this;
+    }
+
     /// @copydoc op_max_view::operator=(const
     /// min_max_internal::rhs_proxy<op_max_view>&)
     reducer_max &operator=(const rhs_proxy &rhs) {
@@ -2601,6 +2706,13 @@ class reducer_min : public reducer<op_min<Type, Compare, true>> {
         return *this;
     }
 
+    /// @copydoc op_min_view::calc_min_range(Iter, Iter)
+    template <typename Iter>
+    reducer_min &calc_min_range(Iter first, Iter last) {
+        view().calc_min_range(first, last);
+        return *this;
+    }
+
     /// @copydoc op_min_view::operator=(const
     /// min_max_internal::rhs_proxy<op_min_view>&)
     reducer_min &operator=(const rhs_proxy &rhs) {
@@ -2816,6 +2928,14 @@ class reducer_max_index
         return *this;
     }
 
+    /// @copydoc op_max_index_view::calc_max_range(Iter, Iter, const Index&)
+    template <typename Iter>
+    reducer_max_index &calc_max_range(Iter first, Iter last,
+                                      const Index &index) {
+        view().calc_max_range(first, last, index);
+        return *this;
+    }
+
     /// @copydoc op_max_view::operator=(const
     /// min_max_internal::rhs_proxy<op_max_view>&)
     reducer_max_index &operator=(const rhs_proxy &rhs) {
@@ -3000,6 +3120,14 @@ class reducer_min_index
         return *this;
     }
 
+    /// @copydoc op_min_index_view::calc_min_range(Iter, Iter, const Index&)
+    template <typename Iter>
+    reducer_min_index &calc_min_range(Iter first, Iter last,
+                                      const Index &index) {
+        view().calc_min_range(first, last, index);
+        return *this;
+    }
+
     /// @copydoc op_min_view::operator=(const
     /// min_max_internal::rhs_proxy<op_min_view>&)
     reducer_min_index &operator=(const rhs_proxy &rhs) {
@@ -3096,6 +3224,23 @@ struct legacy_reducer_downcast<
 };
 /// @endcond
 
+#if COMM_REDUCER
+/** The minimum and maximum of a set of values do not depend on the order
+ *  in which they are combined, so op_min and op_max monoids may be used with
+ *  @ref comm_reducer.  (The index reducers may not, since the index reported
+ *  for equal values depends on the order.)
+ */
+template <typename Type, typename Compare, bool Align>
+struct is_commutative<op_max<Type, Compare, Align>> {
+    static const bool value = true;
+};
+
+template <typename Type, typename Compare, bool Align>
+struct is_commutative<op_min<Type, Compare, Align>> {
+    static const bool value = true;
+};
+#endif
+
 } // namespace cilk
 
 #endif // __cplusplus
@@ -58,6 +58,7 @@
 #define REDUCER_OPADD_H_INCLUDED
 
 #include <cilk/reducer.h>
+#include <cilk/range_kernels.h>
 
 /** @defgroup ReducersAdd Addition Reducers
  *
@@ -305,6 +306,18 @@ public:
      */
     op_add_view& operator-=(const Type& x) { this->m_value -= x; return *this; }
 
+    /** Adds the elements of [@a first, @a last) to the accumulator
+     *  variable. This looks up the view once for the whole range, and sums
+     *  a range given by pointers with vectorized code.
+     */
+    template <typename Iter>
+    op_add_view& add_range(Iter first, Iter last)
+    {
+        this->m_value = range_internal::fold(first, last, this->m_value,
+                                             range_internal::plus_op<Type>());
+        return *this;
+    }
+
     /** Pre-increment.
      */
     op_add_view& operator++() { ++this->m_value; return *this; }
@@ -457,6 +470,14 @@ class reducer_opadd : public reducer< op_add<Type, true> >
     /// @copydoc op_add_view::operator-=(const Type&)
     reducer_opadd& operator-=(const Type& x)    { view() -= x; return *this; }
 
+    /// @copydoc op_add_view::add_range(Iter, Iter)
+    template <typename Iter>
+    reducer_opadd& add_range(Iter first, Iter last)
+    {
+        view().add_range(first, last);
+        return *this;
+    }
+
     /// @copydoc op_add_view::operator++()
     reducer_opadd& operator++()                 { ++view(); return *this; }
 
@@ -560,6 +581,18 @@ struct legacy_reducer_downcast<reducer<op_add<Type, Align> > >
 };
 /// @endcond
 
+#if COMM_REDUCER
+/** Addition is commutative, so an op_add monoid may be used with
+ *  @ref comm_reducer.
+ *
+ *  @ingroup ReducersAdd
+ */
+template <typename Type, bool Align>
+struct is_commutative<op_add<Type, Align> > {
+    static const bool value = true;
+};
+#endif
+
 } // namespace cilk
 
 extern "C" {
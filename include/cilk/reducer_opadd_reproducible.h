@@ -0,0 +1,319 @@
+/** @file reducer_opadd_reproducible.h
+ *
+ *  @brief Defines classes for floating-point addition reducers whose result
+ *  does not depend on how the computation was scheduled.
+ *
+ *  The value of a `cilk::reducer< cilk::op_add<double> >` depends on the
+ *  order in which its views were added, which changes with the number of
+ *  workers and the pattern of steals. A
+ *  `cilk::reducer< cilk::op_add_reproducible<double> >` instead keeps the
+ *  exact sum of its inputs, and rounds it only when the value is read, so
+ *  the result is the same in every run:
+ *
+ *      cilk::reducer< cilk::op_add_reproducible<double> > sum;
+ *      cilk_for (int i = 0; i < n; ++i)
+ *          *sum += a[i];
+ *      double total = sum.get_value(); // the exact sum, correctly rounded
+ *
+ *  Each view is a fixed-point superaccumulator wide enough for any sum of
+ *  doubles. Adding a value touches three of its digits; reducing two views
+ *  adds their digits with a loop the compiler can vectorize.
+ *
+ *  @ingroup ReducersAddReproducible
+ */
+
+#ifndef REDUCER_OPADD_REPRODUCIBLE_H_INCLUDED
+#define REDUCER_OPADD_REPRODUCIBLE_H_INCLUDED
+
+#include <cilk/reducer.h>
+
+#ifdef __cplusplus
+
+#if __cplusplus < 201103L
+#error "reducer_opadd_reproducible.h requires C++11"
+#endif
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+namespace cilk {
+
+namespace reproducible_internal {
+
+/** Exact sum of doubles, as a fixed-point number in units of the smallest
+ *  subnormal, 2^-1074. The number is stored in base 2^32, with each signed
+ *  64-bit digit left room to absorb carries; carries are propagated only
+ *  when a digit could overflow, or when the value is read.
+ *
+ *  Infinities and NaNs are recorded separately, so the result for them is
+ *  the same as for a serial sum.
+ */
+class superaccumulator {
+  public:
+    enum {
+        digit_bits = 32,
+        // Doubles occupy bits 0 through 2098 of the sum, the first 66
+        // digits; the other two hold the carries of up to 2^64 additions.
+        digits = 68
+    };
+
+  private:
+    static const std::uint64_t digit_mask = 0xffffffffu;
+
+    // The digits may each have grown by less than 2^33 per addition since
+    // they were last normalized, and must stay below 2^63.
+    static const std::uint32_t pending_limit = 1u << 29;
+
+    enum { nan = 1, pos_inf = 2, neg_inf = 4 };
+
+    std::int64_t m_digit[digits] __attribute__((aligned(64)));
+    std::uint32_t m_pending; // additions since the digits were normalized
+    unsigned m_special;      // nan, pos_inf and neg_inf bits
+
+    /* Propagate carries so that each digit but the last is in
+       [0, 2^32); the last holds the sign. */
+    static void normalize(std::int64_t *digit) {
+        for (int k = 0; k < digits - 1; ++k) {
+            std::int64_t carry = digit[k] >> digit_bits;
+            digit[k] &= digit_mask;
+            digit[k + 1] += carry;
+        }
+    }
+
+    void normalize() {
+        normalize(m_digit);
+        m_pending = 0;
+    }
+
+    /* Round the nonnegative normalized number in digit to a double. */
+    static double round(const std::int64_t *digit) {
+        int h = digits - 1;
+        while (h >= 0 && digit[h] == 0)
+            --h;
+        if (h <= 1) {
+            // Below 2^64 units, the conversion rounds correctly, and
+            // scaling the result is exact even if it is subnormal.
+            std::uint64_t n = std::uint64_t(h < 0 ? 0 : digit[0]) |
+                              std::uint64_t(h < 1 ? 0 : digit[1]) << 32;
+            return std::ldexp(double(n), -1074);
+        }
+        // Take the leading 64 bits of the sum, and note whether any of the
+        // bits below them are set.
+        std::uint64_t top = std::uint64_t(digit[h]) << digit_bits |
+                            std::uint64_t(digit[h - 1]);
+        std::uint64_t next = std::uint64_t(digit[h - 2]);
+        int lz = __builtin_clzll(top);
+        bool sticky = false;
+        for (int k = 0; k < h - 2 && !sticky; ++k)
+            sticky = digit[k] != 0;
+        if (lz) {
+            top = top << lz | next >> (digit_bits - lz);
+            sticky = sticky || (next & (digit_mask >> lz)) != 0;
+        } else {
+            sticky = sticky || next != 0;
+        }
+        // Round the 64 bits to the 53 of a double, to nearest even.
+        std::uint64_t mant = top >> 11, rest = top & 0x7ff;
+        if (rest > 0x400 || (rest == 0x400 && (sticky || (mant & 1))))
+            ++mant;
+        return std::ldexp(double(mant),
+                          digit_bits * (h - 1) - lz + 11 - 1074);
+    }
+
+  public:
+    superaccumulator() { clear(); }
+
+    void clear() {
+        std::memset(m_digit, 0, sizeof m_digit);
+        m_pending = 0;
+        m_special = 0;
+    }
+
+    void add(double x) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &x, sizeof bits);
+        unsigned exp = (bits >> 52) & 0x7ff;
+        std::uint64_t mant = bits & ((std::uint64_t(1) << 52) - 1);
+        bool negative = bits >> 63;
+        if (exp == 0x7ff) {
+            m_special |= mant ? nan : negative ? neg_inf : pos_inf;
+            return;
+        }
+        // x is mant * 2^pos units.
+        unsigned pos = 0;
+        if (exp) {
+            mant |= std::uint64_t(1) << 52;
+            pos = exp - 1;
+        }
+        if (m_pending >= pending_limit)
+            normalize();
+        ++m_pending;
+        unsigned k = pos / digit_bits, shift = pos % digit_bits;
+        std::uint64_t lo = (mant & digit_mask) << shift;
+        std::uint64_t hi = (mant >> digit_bits) << shift;
+        std::int64_t d0 = lo & digit_mask;
+        std::int64_t d1 = (lo >> digit_bits) + (hi & digit_mask);
+        std::int64_t d2 = hi >> digit_bits;
+        if (negative) {
+            d0 = -d0;
+            d1 = -d1;
+            d2 = -d2;
+        }
+        m_digit[k] += d0;
+        m_digit[k + 1] += d1;
+        m_digit[k + 2] += d2;
+    }
+
+    /** Add other into this accumulator. Other may be normalized. */
+    void add(superaccumulator &other) {
+        if (m_pending + other.m_pending + 1 >= pending_limit) {
+            normalize();
+            other.normalize();
+        }
+        for (int k = 0; k < digits; ++k)
+            m_digit[k] += other.m_digit[k];
+        m_pending += other.m_pending + 1;
+        m_special |= other.m_special;
+    }
+
+    /** The sum, rounded to nearest. An exact zero is +0. */
+    double value() const {
+        if (m_special & nan || (m_special & pos_inf && m_special & neg_inf))
+            return std::numeric_limits<double>::quiet_NaN();
+        if (m_special) {
+            double inf = std::numeric_limits<double>::infinity();
+            return m_special & pos_inf ? inf : -inf;
+        }
+        std::int64_t digit[digits];
+        std::memcpy(digit, m_digit, sizeof digit);
+        normalize(digit);
+        if (digit[digits - 1] >= 0)
+            return round(digit);
+        for (int k = 0; k < digits; ++k)
+            digit[k] = -digit[k];
+        normalize(digit);
+        return -round(digit);
+    }
+};
+
+inline void *aligned_allocate(std::size_t s) {
+    void *p;
+    if (posix_memalign(&p, alignof(superaccumulator), s))
+        throw std::bad_alloc();
+    return p;
+}
+
+inline void aligned_deallocate(void *p) { std::free(p); }
+
+} // namespace reproducible_internal
+
+/** @defgroup ReducersAddReproducible Reproducible Addition Reducers
+ *
+ *  Reproducible addition reducers sum floating-point values exactly, so
+ *  that the result is the same for every schedule.
+ *
+ *  @ingroup Reducers
+ */
+//@{
+
+/** The reproducible addition view class.
+ *
+ *  The view allows only `+=` and `-=` of values, and additions of ranges.
+ *
+ *  @tparam Type    `double` or `float`. Float sums are rounded to double,
+ *                  then to float.
+ */
+template <typename Type> class op_add_reproducible_view {
+    __CILKRTS_STATIC_ASSERT((std::is_same<Type, double>::value ||
+                             std::is_same<Type, float>::value),
+                            "op_add_reproducible requires double or float");
+
+    reproducible_internal::superaccumulator m_acc;
+
+  public:
+    /// Required by cilk::monoid_with_view
+    typedef Type value_type;
+
+    /** Identity constructor. */
+    op_add_reproducible_view() {}
+
+    /** Construct with an initial value. */
+    explicit op_add_reproducible_view(const Type &v) { m_acc.add(v); }
+
+    /** Reduces the views of two strands. */
+    void reduce(op_add_reproducible_view *right) { m_acc.add(right->m_acc); }
+
+    /** @name Reducer support. */
+    //@{
+
+    void view_move_in(Type &v) { view_set_value(v); }
+    void view_move_out(Type &v) { v = view_get_value(); }
+    void view_set_value(const Type &v) {
+        m_acc.clear();
+        m_acc.add(v);
+    }
+    Type view_get_value() const { return Type(m_acc.value()); }
+
+    //@}
+
+    /** @name View modifier operations. */
+    //@{
+
+    op_add_reproducible_view &operator+=(const Type &x) {
+        m_acc.add(x);
+        return *this;
+    }
+
+    op_add_reproducible_view &operator-=(const Type &x) {
+        m_acc.add(-x);
+        return *this;
+    }
+
+    /** Adds the elements of [@a first, @a last). */
+    template <typename Iter>
+    op_add_reproducible_view &add_range(Iter first, Iter last) {
+        for (; first != last; ++first)
+            m_acc.add(*first);
+        return *this;
+    }
+
+    //@}
+};
+
+/** Monoid class for reproducible addition reductions.
+ *
+ *  @tparam Type    `double` or `float`.
+ *  @tparam Align   If true, the reducer itself is cache-aligned.
+ */
+template <typename Type = double, bool Align = false>
+struct op_add_reproducible
+    : public monoid_with_view<op_add_reproducible_view<Type>, Align> {
+    /** The digits of a view are cache-aligned, which operator new does not
+     *  guarantee, so views are allocated on cache-line boundaries. */
+    void *allocate(std::size_t s) const {
+        return reproducible_internal::aligned_allocate(s);
+    }
+    void deallocate(void *p) const {
+        reproducible_internal::aligned_deallocate(p);
+    }
+};
+
+//@}
+
+#if COMM_REDUCER
+template <typename Type, bool Align>
+struct is_commutative<op_add_reproducible<Type, Align> > {
+    static const bool value = true;
+};
+#endif
+
+} // namespace cilk
+
+#endif // __cplusplus
+
+#endif // REDUCER_OPADD_REPRODUCIBLE_H_INCLUDED
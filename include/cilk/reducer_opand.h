@@ -58,6 +58,7 @@
 #define REDUCER_OPAND_H_INCLUDED
 
 #include <cilk/reducer.h>
+#include <cilk/range_kernels.h>
 
 /** @defgroup ReducersAnd Bitwise AND Reducers
  *
@@ -270,6 +271,17 @@ public:
      */
     op_and_view& operator&=(const Type& x) { this->m_value &= x; return *this; }
 
+    /** Performs AND between the accumulator variable and the elements of
+     *  [@a first, @a last).
+     */
+    template <typename Iter>
+    op_and_view& and_range(Iter first, Iter last)
+    {
+        this->m_value = range_internal::fold(first, last, this->m_value,
+                                             range_internal::and_op<Type>());
+        return *this;
+    }
+
     /** Creates an object representing `*this & x`.
      *
      *  @see rhs_proxy
@@ -391,6 +403,14 @@ public:
         return *this;
     }
 
+    /// @copydoc op_and_view::and_range(Iter, Iter)
+    template <typename Iter>
+    reducer_opand& and_range(Iter first, Iter last)
+    {
+        view().and_range(first, last);
+        return *this;
+    }
+
     // The legacy definition of reducer_opand::operator&() has different
     // behavior and a different return type than this definition. The legacy
     // version is defined as a member function, so this new version is defined
@@ -477,6 +497,18 @@ struct legacy_reducer_downcast<reducer<op_and<Type, Align> > >
 };
 /// @endcond
 
+#if COMM_REDUCER
+/** Bitwise and is commutative, so an op_and monoid may be used with
+ *  @ref comm_reducer.
+ *
+ *  @ingroup ReducersAnd
+ */
+template <typename Type, bool Align>
+struct is_commutative<op_and<Type, Align> > {
+    static const bool value = true;
+};
+#endif
+
 } // namespace cilk
 
 #endif // __cplusplus
@@ -58,6 +58,7 @@
 #define REDUCER_OPMUL_H_INCLUDED
 
 #include <cilk/reducer.h>
+#include <cilk/range_kernels.h>
 
 /** @defgroup ReducersMul Multiplication Reducers
  *
@@ -279,6 +280,17 @@ public:
      */
     op_mul_view& operator*=(const Type& x) { this->m_value *= x; return *this; }
 
+    /** Multiplies the accumulator variable by the elements of [@a first,
+     *  @a last).
+     */
+    template <typename Iter>
+    op_mul_view& mul_range(Iter first, Iter last)
+    {
+        this->m_value = range_internal::fold(first, last, this->m_value,
+                                             range_internal::times_op<Type>());
+        return *this;
+    }
+
     /** Creates an object representing `*this * x`.
      *
      *  @see rhs_proxy
@@ -58,6 +58,7 @@
 #define REDUCER_OPOR_H_INCLUDED
 
 #include <cilk/reducer.h>
+#include <cilk/range_kernels.h>
 
 /** @defgroup ReducersOr Bitwise `OR` Reducers
  *
@@ -267,6 +268,17 @@ public:
      */
     op_or_view& operator|=(const Type& x) { this->m_value |= x; return *this; }
 
+    /** Performs OR between the accumulator variable and the elements of
+     *  [@a first, @a last).
+     */
+    template <typename Iter>
+    op_or_view& or_range(Iter first, Iter last)
+    {
+        this->m_value = range_internal::fold(first, last, this->m_value,
+                                             range_internal::or_op<Type>());
+        return *this;
+    }
+
     /** Creates an object representing `*this | x`.
      *
      *  @see rhs_proxy
@@ -386,6 +398,14 @@ class reducer_opor : public reducer< op_or<Type, true> >
         view() |= x; return *this;
     }
 
+    /// @copydoc op_or_view::or_range(Iter, Iter)
+    template <typename Iter>
+    reducer_opor& or_range(Iter first, Iter last)
+    {
+        view().or_range(first, last);
+        return *this;
+    }
+
     // The legacy definition of reducer_opor::operator|() has different
     // behavior and a different return type than this definition. The legacy
     // version is defined as a member function, so this new version is defined
@@ -472,6 +492,18 @@ struct legacy_reducer_downcast<reducer<op_or<Type, Align> > >
 };
 /// @endcond
 
+#if COMM_REDUCER
+/** Bitwise or is commutative, so an op_or monoid may be used with
+ *  @ref comm_reducer.
+ *
+ *  @ingroup ReducersOr
+ */
+template <typename Type, bool Align>
+struct is_commutative<op_or<Type, Align> > {
+    static const bool value = true;
+};
+#endif
+
 } // namespace cilk
 
 #endif /* __cplusplus */
@@ -58,6 +58,7 @@
 #define REDUCER_OPXOR_H_INCLUDED
 
 #include <cilk/reducer.h>
+#include <cilk/range_kernels.h>
 
 /** @defgroup ReducersXor Bitwise XOR Reducers
  *
@@ -266,6 +267,17 @@ public:
      */
     op_xor_view& operator^=(const Type& x) { this->m_value ^= x; return *this; }
 
+    /** Performs XOR between the accumulator variable and the elements of
+     *  [@a first, @a last).
+     */
+    template <typename Iter>
+    op_xor_view& xor_range(Iter first, Iter last)
+    {
+        this->m_value = range_internal::fold(first, last, this->m_value,
+                                             range_internal::xor_op<Type>());
+        return *this;
+    }
+
     /** Creates an object representing `*this ^ x`.
      *
      *  @see rhs_proxy
@@ -385,6 +397,14 @@ class reducer_opxor : public reducer< op_xor<Type, true> >
         view() ^= x; return *this;
     }
 
+    /// @copydoc op_xor_view::xor_range(Iter, Iter)
+    template <typename Iter>
+    reducer_opxor& xor_range(Iter first, Iter last)
+    {
+        view().xor_range(first, last);
+        return *this;
+    }
+
     // The legacy definition of reducer_opxor::operator^() has different
     // behavior and a different return type than this definition. The legacy
     // version is defined as a member function, so this new version is defined
@@ -471,6 +491,18 @@ struct legacy_reducer_downcast<reducer<op_xor<Type, Align> > >
 };
 /// @endcond
 
+#if COMM_REDUCER
+/** Bitwise exclusive or is commutative, so an op_xor monoid may be used with
+ *  @ref comm_reducer.
+ *
+ *  @ingroup ReducersXor
+ */
+template <typename Type, bool Align>
+struct is_commutative<op_xor<Type, Align> > {
+    static const bool value = true;
+};
+#endif
+
 } // namespace cilk
 
 #endif /* __cplusplus */
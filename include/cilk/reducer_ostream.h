@@ -58,8 +58,12 @@
 #define REDUCER_OSTREAM_H_INCLUDED
 
 #include <cilk/reducer.h>
+#include <cerrno>
+#include <cstddef>
 #include <ostream>
 #include <sstream>
+#include <sys/uio.h>
+#include <unistd.h>
 
 /** @defgroup ReducersOstream Ostream Reducers
  *
@@ -139,12 +143,17 @@
  *
  *  @subsection redostream_constructors Constructors
  *
- *  The only constructor is
+ *  There are two constructors:
  *
  *      reducer(const Ostream& os)
+ *      reducer(int fd)
  *
- *  This creates a reducer that is associated with the existing ostream `os`.
- *  Anything "written to" the reducer will (eventually) be written to `os`.
+ *  The first creates a reducer that is associated with the existing ostream
+ *  `os`. Anything "written to" the reducer will (eventually) be written to
+ *  `os`. The second writes everything to the open file descriptor `fd`,
+ *  with `writev`, bypassing the ostream machinery of the destination. The
+ *  characters are written unconverted, so it is meant for narrow streams.
+ *  The reducer does not close `fd`.
  *
  *  @subsection redostream_get_set Set and Get
  *
@@ -168,25 +177,32 @@
  *
  *  @section redostream_performance Performance Considerations
  *
- *  Ostream reducers work by creating a string stream for each non-leftmost
- *  view. When two strands are merged, the contents of the string buffer of the
- *  right view are written to the left view. Since all non-leftmost strands are
- *  eventually merged, all output is eventually written to the associated
- *  ostream.
+ *  Ostream reducers work by giving each non-leftmost view a private buffer,
+ *  a chain of fixed-size blocks. When two non-leftmost strands are merged,
+ *  the right view's chain is spliced onto the end of the left view's chain,
+ *  without copying any output. When a strand is merged into the leftmost
+ *  strand, its output is known to follow everything already written, so its
+ *  blocks are written to the associated ostream at once and released.
  *
  *  This implementation has two consequences.
  *
  *  First, all output written to an ostream reducer on a stolen strand is kept
- *  in memory (in a string buffer) until the strand is merged with the leftmost
- *  strand. This means that some portion of the output written to an ostream
- *  reducer during a parallel computation - half of the total output, on
- *  average - will temporarily be held in memory during the computation.
- *  Obviously, ostream reducers will work better for small and moderate amounts
- *  of output.
- *
- *  Second, buffered ostream reducer content must be copied at every merge.
- *  The total amount of copying is potentially proportional to the total amount
- *  of output multiplied by the number of strands stolen during the computation.
+ *  in memory until the strand is merged with the leftmost strand. This means
+ *  that some portion of the output written to an ostream reducer during a
+ *  parallel computation - half of the total output, on average - will
+ *  temporarily be held in memory during the computation. Obviously, ostream
+ *  reducers will work better for small and moderate amounts of output.
+ *
+ *  Second, each character is copied once into a block, and once more when
+ *  the block is written to the ostream. The cost of a merge is independent
+ *  of the amount of output buffered by the strands.
+ *
+ *  A reducer constructed from a file descriptor buffers the leftmost
+ *  strand's output in a chain as well. Whenever the chain grows to 64 KiB,
+ *  at a merge into the leftmost strand, or when the view is flushed (for
+ *  example with `std::flush`), the blocks are handed to a single `writev`
+ *  call, so output appears incrementally as the computation proceeds
+ *  rather than at its end. Flushing a non-leftmost view has no effect.
  *
  *  In short, writing to an ostream in a parallel computation with an ostream
  *  reducer will always be less efficient than writing the same output directly
@@ -227,6 +243,239 @@
 
 namespace cilk {
 
+/// @cond internal
+
+namespace ostream_internal {
+
+/** A stream buffer that stores its output in a chain of fixed-size blocks.
+ *
+ *  Chains are joined in constant time with splice(). Given a file
+ *  descriptor, the buffer writes its chain to it with `writev` when the chain
+ *  reaches flush_blocks blocks, when it is synced, and when it is destroyed;
+ *  without one, the output stays in the chain until write_to() is called.
+ */
+template<typename Char, typename Traits>
+class chain_buf : public std::basic_streambuf<Char, Traits>
+{
+    typedef std::basic_streambuf<Char, Traits> base;
+    typedef typename Traits::int_type          int_type;
+
+    struct block
+    {
+        static const std::size_t capacity =
+            (4096 - 2 * sizeof(void*)) / sizeof(Char);
+
+        block*      next;
+        std::size_t used;
+        Char        data[capacity];
+    };
+
+    // Blocks collected before a buffer with a file descriptor writes them.
+    static const std::size_t flush_blocks = 16;
+    // Blocks handed to one writev call.
+    static const int max_iov = 64;
+
+    block*      m_head;
+    block*      m_tail;     // Block holding the put area, if any
+    std::size_t m_blocks;
+    int         m_fd;       // Destination, or -1
+
+    chain_buf(const chain_buf&);            // Disallow copying
+    chain_buf& operator=(const chain_buf&);
+
+    // Record the length of the put area in the tail block.
+    void commit()
+    {
+        if (m_tail)
+            m_tail->used = this->pptr() - m_tail->data;
+    }
+
+    void put_into(block* b)
+    {
+        this->setp(b->data, b->data + block::capacity);
+        this->pbump(static_cast<int>(b->used));
+    }
+
+    void append_block()
+    {
+        commit();
+        block* b = new block;
+        b->next = 0;
+        b->used = 0;
+        if (m_tail)
+            m_tail->next = b;
+        else
+            m_head = b;
+        m_tail = b;
+        ++m_blocks;
+        put_into(b);
+    }
+
+    // Free every block but the tail, which is emptied for reuse.
+    void release_all_but_tail()
+    {
+        while (m_head != m_tail) {
+            block* next = m_head->next;
+            delete m_head;
+            m_head = next;
+        }
+        if (m_tail) {
+            m_tail->used = 0;
+            m_blocks = 1;
+            put_into(m_tail);
+        }
+    }
+
+    void release()
+    {
+        release_all_but_tail();
+        delete m_tail;
+        m_head = m_tail = 0;
+        m_blocks = 0;
+        this->setp(0, 0);
+    }
+
+    bool write_iov(struct iovec* iov, int n)
+    {
+        while (n > 0) {
+            ssize_t written = ::writev(m_fd, iov, n);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            // Skip what was written, and retry the rest.
+            std::size_t done = written;
+            while (n > 0 && done >= iov->iov_len) {
+                done -= iov->iov_len;
+                ++iov;
+                --n;
+            }
+            if (n > 0) {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+                iov->iov_len -= done;
+            }
+        }
+        return true;
+    }
+
+    // Write the chain to the file descriptor. The output is discarded even
+    // if the write fails, so that a broken destination does not make the
+    // chain grow without bound.
+    bool write_fd()
+    {
+        commit();
+        bool ok = true;
+        for (block* b = m_head; b && ok; ) {
+            struct iovec iov[max_iov];
+            int n = 0;
+            for (; b && n < max_iov; b = b->next) {
+                if (b->used) {
+                    iov[n].iov_base = b->data;
+                    iov[n].iov_len = b->used * sizeof(Char);
+                    ++n;
+                }
+            }
+            ok = write_iov(iov, n);
+        }
+        release_all_but_tail();
+        return ok;
+    }
+
+protected:
+
+    int_type overflow(int_type c)
+    {
+        if (m_fd >= 0 && m_blocks >= flush_blocks && !write_fd())
+            return Traits::eof();
+        if (this->pptr() == this->epptr())
+            append_block();
+        if (!Traits::eq_int_type(c, Traits::eof())) {
+            *this->pptr() = Traits::to_char_type(c);
+            this->pbump(1);
+        }
+        return Traits::not_eof(c);
+    }
+
+    std::streamsize xsputn(const Char* s, std::streamsize n)
+    {
+        std::streamsize done = 0;
+        while (done < n) {
+            if (this->pptr() == this->epptr() &&
+                Traits::eq_int_type(overflow(Traits::eof()), Traits::eof()))
+                break;
+            std::streamsize room = this->epptr() - this->pptr();
+            std::streamsize count = n - done < room ? n - done : room;
+            Traits::copy(this->pptr(), s + done, count);
+            this->pbump(static_cast<int>(count));
+            done += count;
+        }
+        return done;
+    }
+
+    int sync()
+    {
+        return m_fd < 0 || write_fd() ? 0 : -1;
+    }
+
+public:
+
+    chain_buf() : m_head(0), m_tail(0), m_blocks(0), m_fd(-1) {}
+
+    ~chain_buf()
+    {
+        if (m_fd >= 0)
+            write_fd();
+        release();
+    }
+
+    void set_fd(int fd) { m_fd = fd; }
+
+    /** Moves the chain of @a right to the end of this chain, leaving @a right
+     *  empty. A buffer with a file descriptor then writes its chain.
+     *
+     *  @return false if the write failed.
+     */
+    bool splice(chain_buf& right)
+    {
+        right.commit();
+        if (right.m_head) {
+            commit();
+            if (m_tail)
+                m_tail->next = right.m_head;
+            else
+                m_head = right.m_head;
+            m_tail = right.m_tail;
+            m_blocks += right.m_blocks;
+            put_into(m_tail);
+            right.m_head = right.m_tail = 0;
+            right.m_blocks = 0;
+            right.setp(0, 0);
+        }
+        return m_fd < 0 || write_fd();
+    }
+
+    /** Writes the chain to @a dest, and releases it.
+     *
+     *  @return false if @a dest did not accept all of the output.
+     */
+    bool write_to(base* dest)
+    {
+        commit();
+        bool ok = dest != 0;
+        for (block* b = m_head; b && ok; b = b->next) {
+            std::streamsize n = static_cast<std::streamsize>(b->used);
+            ok = n == 0 || dest->sputn(b->data, n) == n;
+        }
+        release();
+        return ok;
+    }
+};
+
+} // namespace ostream_internal
+
+/// @endcond
+
 /** @ingroup ReducersOstream */
 //@{
 
@@ -254,11 +503,12 @@ class op_basic_ostream_view : public std::basic_ostream<Char, Traits>
     typedef std::basic_ostream<Char, Traits>  base;
     typedef std::basic_ostream<Char, Traits>  ostream_type;
 
-    // A non-leftmost view is associated with a private string buffer. (The
-    // leftmost view is associated with the buffer of the reducer's associated
-    // ostream, so its private buffer is unused.)
+    // A non-leftmost view is associated with a private chain buffer. The
+    // leftmost view is associated with the buffer of the reducer's
+    // associated ostream, so its private buffer is unused, unless the
+    // reducer writes to a file descriptor.
     //
-    std::basic_stringbuf<Char, Traits> m_buffer;
+    ostream_internal::chain_buf<Char, Traits> m_buffer;
 
 public:
 
@@ -270,11 +520,16 @@ public:
      */
     void reduce(op_basic_ostream_view* other)
     {
-        // Writing an empty buffer results in failure. Testing `sgetc()` is the
-        // easiest way of checking for an empty buffer.
-        if (other->m_buffer.sgetc() != Traits::eof()) {
-            *this << (&other->m_buffer);
+        bool ok;
+        if (base::rdbuf() == &m_buffer) {
+            ok = m_buffer.splice(other->m_buffer);
+        } else {
+            // The leftmost view of an ostream: everything before the other
+            // view's output has been written, so write it out now.
+            ok = other->m_buffer.write_to(base::rdbuf());
         }
+        if (!ok)
+            base::setstate(std::ios_base::badbit);
     }
 
     /** Non-leftmost (identity) view constructor. The view is associated with
@@ -292,6 +547,14 @@ public:
         base::setstate(os.rdstate());  // Copy error state
     }
 
+    /** Leftmost view constructor. The view writes to a file descriptor
+     *  through its internal buffer.
+     */
+    explicit op_basic_ostream_view(int fd) : base(&m_buffer)
+    {
+        m_buffer.set_fd(fd);
+    }
+
     /** Sets/gets.
      *
      *  These are all no-ops.
@@ -343,14 +606,19 @@ public:
      */
     typedef typename base::view_type view_type;
 
-    /** @name Construct function.
+    /** @name Construct functions.
      *
-     *  The only supported ostream reducer constructor takes a reference to
-     *  an existing ostream.
+     *  An ostream reducer is constructed with a reference to an existing
+     *  ostream, or with an open file descriptor, which the reducer does not
+     *  close.
      *
      *  @param os   The ostream destination for receive all data written to the
      *              reducer.
+     *  @param fd   The file descriptor destination for all data written to
+     *              the reducer.
      */
+    //@{
+
     static void construct(
         op_basic_ostream*   monoid,
         view_type*          view,
@@ -359,6 +627,14 @@ public:
         view_guard vg( new((void*) view) view_type(os) );
         vg.confirm_if( new((void*) monoid) op_basic_ostream );
     }
+
+    static void construct(op_basic_ostream* monoid, view_type* view, int fd)
+    {
+        view_guard vg( new((void*) view) view_type(fd) );
+        vg.confirm_if( new((void*) monoid) op_basic_ostream );
+    }
+
+    //@}
 };
 
 
@@ -442,6 +718,11 @@ public:
      */
     explicit reducer_ostream(const std::ostream &os) : base(os) {}
 
+    /** Constructs an initial `reducer_ostream` that writes to the open file
+     *  descriptor `fd`.
+     */
+    explicit reducer_ostream(int fd) : base(fd) {}
+
     /** Returns a modifiable reference to the underlying 'ostream' object.
      */
     std::ostream& get_reference() { return view(); }
@@ -58,6 +58,7 @@
 #define REDUCER_STRING_H_INCLUDED
 
 #include <cilk/reducer.h>
+#include <cilk/segmented_range.h>
 #include <string>
 #include <list>
 
@@ -242,20 +243,9 @@ class op_basic_string_view
     {
         if (m_list.empty()) return;
 
-        typename list_type::iterator i;
-
-        size_type len = m_string.size();
-        for (i = m_list.begin(); i != m_list.end(); ++i)
-            len += i->size();
-
         string_type result(get_allocator());
-        result.reserve(len);
-
-        for (i = m_list.begin(); i != m_list.end(); ++i)
-            result += *i;
+        internal::concat_segments(result, segments());
         m_list.clear();
-
-        result += m_string;
         result.swap(m_string);
     }
 
@@ -378,6 +368,15 @@ public:
 
     //@}
 
+    /** Segmented access to the value.
+     *
+     *  Returns the strings whose concatenation is the value, without
+     *  concatenating them. The range is invalidated by any update of the
+     *  view or call to get_value().
+     */
+    segmented_range<string_type> segments() const
+        { return segmented_range<string_type>(m_list, m_string); }
+
     /** @name View modifier operations.
      *
      *  @details These simply wrap the corresponding operations on the underlying string.
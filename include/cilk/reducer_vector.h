@@ -58,6 +58,7 @@
 #define REDUCER_VECTOR_H_INCLUDED
 
 #include <cilk/reducer.h>
+#include <cilk/segmented_range.h>
 #include <vector>
 #include <list>
 
@@ -244,20 +245,9 @@ class op_vector_view
     {
         if (m_list.empty()) return;
 
-        typename list_type::iterator i;
-
-        size_type len = m_vector.size();
-        for (i = m_list.begin(); i != m_list.end(); ++i)
-            len += i->size();
-
         vector_type result(get_allocator());
-        result.reserve(len);
-
-        for (i = m_list.begin(); i != m_list.end(); ++i)
-            result.insert(result.end(), i->begin(), i->end());
+        internal::concat_segments(result, segments());
         m_list.clear();
-
-        result.insert(result.end(), m_vector.begin(), m_vector.end());
         result.swap(m_vector);
     }
 
@@ -389,6 +379,19 @@ public:
 
     //@}
 
+    /** Segmented access to the value.
+     *
+     *  Returns the vectors whose concatenation is the value, without
+     *  concatenating them. Consumers that only iterate over the value should
+     *  prefer this to get_value(), which copies every element once. The
+     *  range is invalidated by any update of the view or call to
+     *  get_value().
+     */
+    segmented_range<vector_type> segments() const
+    {
+        return segmented_range<vector_type>(m_list, m_vector);
+    }
+
     /** @name View modifier operations.
      *
      *  @details These simply wrap the corresponding operations on the
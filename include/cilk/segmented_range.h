@@ -0,0 +1,187 @@
+#ifndef _CILK_SEGMENTED_RANGE_H
+#define _CILK_SEGMENTED_RANGE_H
+
+#ifdef __cplusplus
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+#if __cplusplus >= 201103L
+#include <type_traits>
+#endif
+
+namespace cilk {
+
+/** Read-only view of a sequence stored as a series of segments, such as the
+ *  value of a vector or string reducer before it is flattened.  The range
+ *  refers to the segments in place; it is invalidated by any update of the
+ *  container that owns them.  Empty segments are skipped.
+ *
+ *  Iterating over a segmented_range yields the segments in order:
+ *
+ *      for (auto &seg : r->segments())
+ *          for (auto &x : seg)
+ *              consume(x);
+ *
+ *  Segments can also be indexed, so a cilk_for over num_segments() visits
+ *  them in parallel; offset(k) is the position of segment k in the value.
+ */
+template <typename Seq> class segmented_range {
+  public:
+    typedef Seq segment_type;
+    typedef typename Seq::size_type size_type;
+
+  private:
+    typedef std::vector<const Seq *> segment_list;
+
+    segment_list m_segments;
+    std::vector<size_type> m_offsets; // elements before each segment
+    size_type m_size;
+
+    void add(const Seq &seg) {
+        if (seg.empty())
+            return;
+        m_segments.push_back(&seg);
+        m_offsets.push_back(m_size);
+        m_size += seg.size();
+    }
+
+  public:
+    /** Iterator over the segments of the range. */
+    class const_iterator {
+        typename segment_list::const_iterator m_it;
+
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef Seq value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Seq *pointer;
+        typedef const Seq &reference;
+
+        const_iterator() {}
+        explicit const_iterator(typename segment_list::const_iterator it)
+            : m_it(it) {}
+
+        reference operator*() const { return **m_it; }
+        pointer operator->() const { return *m_it; }
+        const_iterator &operator++() {
+            ++m_it;
+            return *this;
+        }
+        const_iterator operator++(int) { return const_iterator(m_it++); }
+        bool operator==(const const_iterator &other) const {
+            return m_it == other.m_it;
+        }
+        bool operator!=(const const_iterator &other) const {
+            return m_it != other.m_it;
+        }
+    };
+
+    /** Construct from a list of segments followed by one last segment. */
+    template <typename List>
+    segmented_range(const List &list, const Seq &last) : m_size(0) {
+        for (typename List::const_iterator i = list.begin(); i != list.end();
+             ++i)
+            add(*i);
+        add(last);
+    }
+
+    /// Total number of elements.
+    size_type size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    /// Number of (nonempty) segments.
+    std::size_t num_segments() const { return m_segments.size(); }
+    const Seq &operator[](std::size_t k) const { return *m_segments[k]; }
+    size_type offset(std::size_t k) const { return m_offsets[k]; }
+
+    /// Index of the segment holding element i of the value.
+    std::size_t segment_of(size_type i) const {
+        return std::upper_bound(m_offsets.begin(), m_offsets.end(), i) -
+               m_offsets.begin() - 1;
+    }
+
+    const_iterator begin() const {
+        return const_iterator(m_segments.begin());
+    }
+    const_iterator end() const { return const_iterator(m_segments.end()); }
+};
+
+namespace internal {
+
+// Elements copied by each strand of a parallel concatenation.  It is a
+// multiple of the word size so that strands filling a vector<bool> never
+// write to the same word.
+enum { concat_grain = 4096 };
+
+template <typename Seq>
+void concat_serial(Seq &result, const segmented_range<Seq> &segs) {
+    result.reserve(segs.size());
+    for (typename segmented_range<Seq>::const_iterator i = segs.begin();
+         i != segs.end(); ++i)
+        result.insert(result.end(), i->begin(), i->end());
+}
+
+#if defined __cilk && __cplusplus >= 201103L
+template <typename Seq>
+void concat_segments(Seq &result, const segmented_range<Seq> &segs,
+                     std::false_type) {
+    concat_serial(result, segs);
+}
+
+/* Size the result once, then copy it in fixed-size chunks of the output,
+   each of which may span several segments, so that one long segment does
+   not serialize the copy. */
+template <typename Seq>
+void concat_segments(Seq &result, const segmented_range<Seq> &segs,
+                     std::true_type) {
+    typedef typename Seq::size_type size_type;
+    size_type len = segs.size();
+    if (len < 2 * concat_grain || segs.num_segments() < 2) {
+        concat_serial(result, segs);
+        return;
+    }
+    result.resize(len);
+    size_type chunks = (len + concat_grain - 1) / concat_grain;
+    _Cilk_for(size_type c = 0; c < chunks; ++c) {
+        size_type begin = c * concat_grain;
+        size_type end = std::min(begin + concat_grain, len);
+        std::size_t k = segs.segment_of(begin);
+        while (begin < end) {
+            const Seq &seg = segs[k];
+            size_type from = begin - segs.offset(k);
+            size_type n = std::min(end - begin, seg.size() - from);
+            std::copy(seg.begin() + from, seg.begin() + from + n,
+                      result.begin() + begin);
+            begin += n;
+            ++k;
+        }
+    }
+}
+#endif
+
+/** Concatenate the segments into result, which must be empty.  The copy is
+ *  parallel when compiled as Cilk and the elements can be default
+ *  constructed and then assigned. */
+template <typename Seq>
+void concat_segments(Seq &result, const segmented_range<Seq> &segs) {
+#if defined __cilk && __cplusplus >= 201103L
+    typedef typename Seq::value_type value_type;
+    concat_segments(
+        result, segs,
+        std::integral_constant<
+            bool, std::is_default_constructible<value_type>::value &&
+                      std::is_copy_assignable<value_type>::value>());
+#else
+    concat_serial(result, segs);
+#endif
+}
+
+} // namespace internal
+
+} // namespace cilk
+
+#endif /* __cplusplus */
+
+#endif /* _CILK_SEGMENTED_RANGE_H */
@@ -1,6 +1,5 @@
 #ifndef _SENTINEL_TESTS_H
 #define _SENTINEL_TESTS_H
-#define HASH_REDUCER 0
 #define PEER_PURE 1
 #define PRUNE_BRANCHES 0
 #define INLINE_TLS 1
@@ -8,6 +7,7 @@
 #define SLOWPATH_LOOKUP 1
 #define INLINE_FULL_LOOKUP 1
 #define INLINE_ALL_TLS 1
-#define COMM_REDUCER 0
+#define COMM_REDUCER 1
 #define BIG_SPA 1
+#define DEFERRED_REDUCE 0
 #endif
@@ -0,0 +1,77 @@
+#ifndef _CILK_WORKER_ALLOCATOR_H
+#define _CILK_WORKER_ALLOCATOR_H
+
+#include <cilk/cilk_api.h>
+
+#ifdef __cplusplus
+
+#include <cstddef>
+#include <new>
+
+namespace cilk {
+
+/** Standard allocator backed by the per-worker free lists of the Cilk
+ *  runtime.  Containers built by parallel strands, for example the views of
+ *  a list or vector reducer, allocate without contending on a global lock.
+ *  All instances are interchangeable: memory allocated through one may be
+ *  freed through any other, on any worker.
+ */
+template <typename T> class worker_allocator {
+  public:
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template <typename U> struct rebind { typedef worker_allocator<U> other; };
+
+    worker_allocator() throw() {}
+    worker_allocator(const worker_allocator &) throw() {}
+    template <typename U>
+    worker_allocator(const worker_allocator<U> &) throw() {}
+
+    T *allocate(size_type n, const void * = 0) {
+        if (n > max_size())
+            throw std::bad_alloc();
+        void *p = __cilkrts_worker_malloc(n * sizeof(T));
+        if (!p)
+            throw std::bad_alloc();
+        return static_cast<T *>(p);
+    }
+
+    void deallocate(T *p, size_type n) {
+        __cilkrts_worker_free(p, n * sizeof(T));
+    }
+
+    size_type max_size() const throw() { return size_type(-1) / sizeof(T); }
+
+#if __cplusplus < 201103L
+    // C++03 containers construct elements through the allocator; later
+    // ones use std::allocator_traits, which also handles move-only types.
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+    void construct(pointer p, const T &x) { ::new ((void *)p) T(x); }
+    void destroy(pointer p) { p->~T(); }
+#endif
+};
+
+template <typename T, typename U>
+inline bool operator==(const worker_allocator<T> &,
+                       const worker_allocator<U> &) throw() {
+    return true;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const worker_allocator<T> &,
+                       const worker_allocator<U> &) throw() {
+    return false;
+}
+
+} // namespace cilk
+
+#endif /* __cplusplus */
+
+#endif /* _CILK_WORKER_ALLOCATOR_H */
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <cilk/cilk.h>
+#include <cilk/reducer_min_max.h>
+#include <cilk/reducer_opadd.h>
+#include <cilk/reducer_opand.h>
+#include <cilk/reducer_opor.h>
+#include <cilk/reducer_opxor.h>
+
+extern "C" {
+#include "ktiming.h"
+}
+
+// Commutative reducer benchmark.  Each loop updates a single reducer from
+// every iteration, once through cilk::reducer and once through
+// cilk::comm_reducer, for each of the monoids that comm_reducer supports.
+// Without COMM_REDUCER only the cilk::reducer loops are run.
+
+typedef unsigned long word;
+
+static word key(int i) { return (word)i * 0x9E3779B97F4A7C15UL; }
+
+template <class Reducer> static bool test_add(int n) {
+    Reducer r;
+    cilk_for(int i = 0; i < n; i++) { *r += 1; }
+    return r.get_value() == (long)n;
+}
+
+template <class Reducer> static bool test_or(int n) {
+    Reducer r;
+    cilk_for(int i = 0; i < n; i++) { *r |= 1UL << (i % 64); }
+    return r.get_value() == (n >= 64 ? ~0UL : (1UL << n) - 1);
+}
+
+template <class Reducer> static bool test_and(int n) {
+    Reducer r(~0UL);
+    cilk_for(int i = 0; i < n; i++) { *r &= ~(1UL << (i % 64)); }
+    return r.get_value() == (n >= 64 ? 0UL : ~((1UL << n) - 1));
+}
+
+template <class Reducer> static bool test_xor(int n) {
+    Reducer r;
+    cilk_for(int i = 0; i < n; i++) { *r ^= key(i); }
+    word expect = 0;
+    for (int i = 0; i < n; i++)
+        expect ^= key(i);
+    return r.get_value() == expect;
+}
+
+template <class Reducer> static bool test_min(int n) {
+    Reducer r;
+    cilk_for(int i = 0; i < n; i++) { r->calc_min(key(i)); }
+    word expect = key(0);
+    for (int i = 1; i < n; i++)
+        if (key(i) < expect)
+            expect = key(i);
+    return r.get_value() == expect;
+}
+
+template <class Reducer> static bool test_max(int n) {
+    Reducer r;
+    cilk_for(int i = 0; i < n; i++) { r->calc_max(key(i)); }
+    word expect = key(0);
+    for (int i = 1; i < n; i++)
+        if (key(i) > expect)
+            expect = key(i);
+    return r.get_value() == expect;
+}
+
+static int res, runs;
+
+static void run(const char *name, bool (*test)(int), int n) {
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+
+    for (int i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        res += test(n) ? 1 : 0;
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    runs += TIMING_COUNT;
+    printf("%s:\n", name);
+    print_runtime(running_time, TIMING_COUNT);
+}
+
+#if COMM_REDUCER
+#define RUN(Test, Monoid)                                                      \
+    run(#Monoid, Test<cilk::reducer<cilk::Monoid> >, n);                      \
+    run("comm " #Monoid, Test<cilk::comm_reducer<cilk::Monoid> >, n)
+#else
+#define RUN(Test, Monoid) run(#Monoid, Test<cilk::reducer<cilk::Monoid> >, n)
+#endif
+
+int main(int argc, const char **args) {
+    int n;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: commsum [<cilk-options>] <n>\n");
+        exit(1);
+    }
+
+    n = atoi(args[1]);
+    if (n < 1) {
+        fprintf(stderr, "commsum: n must be positive\n");
+        exit(1);
+    }
+
+    RUN(test_add, op_add<long>);
+    RUN(test_or, op_or<word>);
+    RUN(test_and, op_and<word>);
+    RUN(test_xor, op_xor<word>);
+    RUN(test_min, op_min<word>);
+    RUN(test_max, op_max<word>);
+
+    printf("Result: %d/%d successes!\n", res, runs);
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <list>
+#include <memory>
+#include <cilk/cilk.h>
+#include <cilk/reducer_list.h>
+
+extern "C" {
+#include "ktiming.h"
+}
+
+// List reducer benchmark, a C++ version of intlist.  Builds the list of the
+// integers in [0, n) by divide and conquer, once with the worker allocator
+// and once with the default std::allocator.
+
+template <typename Reducer>
+static void ilist_dac(Reducer &r, int lo, int hi, int base) {
+    if (hi - lo < base) {
+        for (int i = lo; i < hi; i++)
+            r->push_back(i);
+        return;
+    }
+
+    int mid = (lo + hi) / 2;
+
+    cilk_spawn ilist_dac(r, lo, mid, base);
+    ilist_dac(r, mid, hi, base);
+    cilk_sync;
+}
+
+template <typename List>
+static bool check(const List &list, int n) {
+    int curr = 0;
+    for (typename List::const_iterator it = list.begin(); it != list.end();
+         ++it, ++curr)
+        if (*it != curr)
+            return false;
+    return curr == n;
+}
+
+template <typename Monoid>
+static bool test_list(int n, int b) {
+    cilk::reducer<Monoid> r;
+    ilist_dac(r, 0, n, b);
+    return check(r.get_value(), n);
+}
+
+static int res, runs;
+
+static void run(const char *name, bool (*test)(int, int), int n, int b) {
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+
+    for (int i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        res += test(n, b) ? 1 : 0;
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    runs += TIMING_COUNT;
+    printf("%s:\n", name);
+    print_runtime(running_time, TIMING_COUNT);
+}
+
+int main(int argc, const char **args) {
+    int n, b = 4;
+
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: cpplist [<cilk-options>] <n> [<b>]\n");
+        exit(1);
+    }
+
+    n = atoi(args[1]);
+    if (argc == 3)
+        b = atoi(args[2]);
+    if (n < 1 || b < 1) {
+        fprintf(stderr, "cpplist: n and b must be positive\n");
+        exit(1);
+    }
+
+    run("worker_allocator",
+        test_list<cilk::op_list_append<int, cilk::worker_allocator<int> > >,
+        n, b);
+    run("std::allocator", test_list<cilk::op_list_append<int> >, n, b);
+
+    printf("Result: %d/%d successes!\n", res, runs);
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <cilk/cilk.h>
+#include <cilk/reducer_array.h>
+
+extern "C" {
+#include "ktiming.h"
+}
+
+// Histogram benchmark.  Every iteration adds one to a pseudo-random bin of
+// an array reducer, once with a compile-time number of bins and once with
+// the number given on the command line.
+
+#define FIXED_BINS 4096
+
+static unsigned bin_of(long i, unsigned bins) {
+    unsigned long x = (unsigned long)i * 0x9E3779B97F4A7C15UL;
+    return (unsigned)((x >> 32) % bins);
+}
+
+static bool check(const long *counts, long n, unsigned bins) {
+    long *expect = (long *)calloc(bins, sizeof(long));
+    for (long i = 0; i < n; i++)
+        expect[bin_of(i, bins)]++;
+    bool ok = true;
+    for (unsigned b = 0; b < bins; b++)
+        ok = ok && counts[b] == expect[b];
+    free(expect);
+    return ok;
+}
+
+// Each test times the loop and the final reduction, but not the check.
+
+static bool test_fixed(long n, uint64_t *time) {
+    clockmark_t begin = ktiming_getmark();
+    cilk::reducer<cilk::op_array_add<long, FIXED_BINS> > hist;
+    cilk_for(long i = 0; i < n; i++) { hist->add(bin_of(i, FIXED_BINS)); }
+    const long *counts = hist.get_value().data();
+    clockmark_t end = ktiming_getmark();
+    *time = ktiming_diff_nsec(&begin, &end);
+    return check(counts, n, FIXED_BINS);
+}
+
+static bool test_sized(long n, unsigned bins, uint64_t *time) {
+    clockmark_t begin = ktiming_getmark();
+    cilk::reducer<cilk::op_array_add<long> > hist(bins);
+    cilk_for(long i = 0; i < n; i++) { hist->add(bin_of(i, bins)); }
+    const long *counts = hist.get_value().data();
+    clockmark_t end = ktiming_getmark();
+    *time = ktiming_diff_nsec(&begin, &end);
+    return check(counts, n, bins);
+}
+
+int main(int argc, const char **args) {
+    int i;
+    long n;
+    unsigned bins;
+    int res = 0;
+    uint64_t fixed_time[TIMING_COUNT], sized_time[TIMING_COUNT];
+
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: histogram [<cilk-options>] <n> [<bins>]\n");
+        exit(1);
+    }
+
+    n = atol(args[1]);
+    bins = argc == 3 ? atoi(args[2]) : FIXED_BINS;
+    if (bins < 1) {
+        fprintf(stderr, "histogram: bins must be positive\n");
+        exit(1);
+    }
+
+    for (i = 0; i < TIMING_COUNT; i++) {
+        res += test_fixed(n, &fixed_time[i]) ? 1 : 0;
+        res += test_sized(n, bins, &sized_time[i]) ? 1 : 0;
+    }
+    printf("Result: %d/%d successes!\n", res, 2 * TIMING_COUNT);
+    printf("%d bins:\n", FIXED_BINS);
+    print_runtime(fixed_time, TIMING_COUNT);
+    printf("%u bins, sized at run time:\n", bins);
+    print_runtime(sized_time, TIMING_COUNT);
+
+    return 0;
+}
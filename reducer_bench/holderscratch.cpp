@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <cilk/cilk.h>
+#include <cilk/holder.h>
+#include <cilk/reducer_opadd.h>
+
+extern "C" {
+#include "ktiming.h"
+}
+
+// Holder benchmark.  Each block of a cilk_for works in a large scratch
+// buffer held by a holder, which makes a new buffer for every stolen strand.
+// With holder_keep_persistent, the buffers are kept by the workers and
+// reused by the following loops.
+
+#define BLOCK 1024
+
+static long scratch_size;
+static long constructed;
+
+struct scratch {
+    std::vector<long> buf;
+    scratch() : buf(scratch_size) { __sync_fetch_and_add(&constructed, 1); }
+};
+
+// Sum of the squares in [b * BLOCK, (b + 1) * BLOCK), staged in the scratch
+// buffer.
+template <typename Holder> static long block_sum(Holder &h, long b) {
+    std::vector<long> &buf = h().buf;
+    long sum = 0;
+    for (long i = 0; i < BLOCK; i++) {
+        long x = b * BLOCK + i;
+        buf[i % scratch_size] = x * x;
+        sum += buf[i % scratch_size];
+    }
+    return sum;
+}
+
+template <typename Holder> static bool test_holder(long n, long loops) {
+    Holder h;
+    bool ok = true;
+    for (long l = 0; l < loops; l++) {
+        cilk::reducer<cilk::op_add<long> > sum;
+        cilk_for(long b = 0; b < n / BLOCK; b++) { *sum += block_sum(h, b); }
+        long m = n / BLOCK * BLOCK - 1;
+        ok = ok && sum.get_value() == m * (m + 1) * (2 * m + 1) / 6;
+    }
+    return ok;
+}
+
+static int res, runs;
+
+static void run(const char *name, bool (*test)(long, long), long n,
+                long loops) {
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+
+    constructed = 0;
+    for (int i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        res += test(n, loops) ? 1 : 0;
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    runs += TIMING_COUNT;
+    printf("%s: %.1f scratch buffers per run\n", name,
+           (double)constructed / TIMING_COUNT);
+    print_runtime(running_time, TIMING_COUNT);
+}
+
+int main(int argc, const char **args) {
+    long n, loops = 16;
+
+    if (argc != 3 && argc != 4) {
+        fprintf(stderr, "Usage: holderscratch [<cilk-options>] <n> <scratch> "
+                        "[<loops>]\n");
+        exit(1);
+    }
+
+    n = atol(args[1]);
+    scratch_size = atol(args[2]);
+    if (argc == 4)
+        loops = atol(args[3]);
+    if (n < BLOCK || scratch_size < 1 || loops < 1) {
+        fprintf(stderr, "holderscratch: n must be at least %d, and scratch "
+                        "and loops positive\n", BLOCK);
+        exit(1);
+    }
+
+    run("holder_keep_indeterminate", test_holder<cilk::holder<scratch> >, n,
+        loops);
+    run("holder_keep_persistent",
+        test_holder<cilk::holder<scratch, cilk::holder_keep_persistent> >, n,
+        loops);
+
+    printf("Result: %d/%d successes!\n", res, runs);
+    return 0;
+}
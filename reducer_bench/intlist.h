@@ -1,9 +1,16 @@
 #ifndef _INTLIST_H
 #define _INTLIST_H
 
+#include <cilk/cilk_api.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+// List nodes come from the worker-local allocator; build with
+// WORKER_MALLOC=0 to compare against malloc.
+#ifndef WORKER_MALLOC
+#define WORKER_MALLOC 1
+#endif
+
 typedef struct _intListNode {
   int value;
   struct _intListNode* next;
@@ -18,7 +25,11 @@ void IntList_init(IntList* list) {
 // Append an integer to the list
 void IntList_append(IntList* list, int x)
 {
+#if WORKER_MALLOC
+  IntListNode* node = (IntListNode*) __cilkrts_worker_malloc(sizeof(IntListNode));
+#else
   IntListNode* node = (IntListNode*) malloc(sizeof(IntListNode));
+#endif
   node->value = x;
   node->next = NULL;
     
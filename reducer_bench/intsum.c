@@ -15,26 +15,60 @@ CILK_C_DECLARE_REDUCER(long)
 my_int_sum_reducer = CILK_C_INIT_REDUCER(long, reduce_longsum, identity_longsum,
                                          0, 0);
 
+// Always call the runtime, to compare with the inline fast path of
+// REDUCER_VIEW.
+#define REDUCER_VIEW_CALL(Expr)                                                \
+    (*(_Typeof((Expr).value) *)__cilkrts_hyper_lookup(                         \
+        &(Expr).__cilkrts_hyperbase))
+
 void compute_sum(long limit, int scale) {
     for (long i = 0; i < limit; i++) {
         REDUCER_VIEW(my_int_sum_reducer) += scale;
     }
 }
 
-void test_reducer(long limit) {
+void compute_sum_call(long limit, int scale) {
+    for (long i = 0; i < limit; i++) {
+        REDUCER_VIEW_CALL(my_int_sum_reducer) += scale;
+    }
+}
+
+// compute_sum does not spawn, so the view can be looked up once per call.
+void compute_sum_scope(long limit, int scale) {
+    CILK_C_VIEW_SCOPE(my_int_sum_reducer, sum);
+    for (long i = 0; i < limit; i++) {
+        *sum += scale;
+    }
+}
+
+void test_reducer(long limit, void (*compute)(long, int)) {
     #pragma GCC diagnostic ignored "-Wpass-failed"
     for (int t = 1; t < 100; ++t) {
-        cilk_spawn compute_sum(limit, t);
+        cilk_spawn compute(limit, t);
     }
-    compute_sum(limit, 100);
+    compute(limit, 100);
     cilk_sync;
 }
 
+static uint64_t fastest(const uint64_t *running_time, int count) {
+    uint64_t best = running_time[0];
+    for (int i = 1; i < count; i++)
+        if (running_time[i] < best)
+            best = running_time[i];
+    return best;
+}
+
 int main(int argc, const char **args) {
     long i, n;
     int res = 0;
     clockmark_t begin, end;
     uint64_t running_time[TIMING_COUNT];
+    uint64_t call_running_time[TIMING_COUNT];
+    uint64_t scope_running_time[TIMING_COUNT];
+    void (*compute[3])(long, int) = {compute_sum, compute_sum_call,
+                                     compute_sum_scope};
+    uint64_t *times[3] = {running_time, call_running_time,
+                          scope_running_time};
 
     if (argc != 2) {
         fprintf(stderr, "Usage: ilist_dac [<cilk-options>] <n>\n");
@@ -45,20 +79,29 @@ int main(int argc, const char **args) {
 
     const long scale = 100 * 101 / 2;
 
-    for (i = 0; i < TIMING_COUNT; i++) {
+    for (i = 0; i < 3 * TIMING_COUNT; i++) {
+        int variant = i / TIMING_COUNT;
         begin = ktiming_getmark();
         CILK_C_REGISTER_REDUCER(my_int_sum_reducer);
         *(&REDUCER_VIEW(my_int_sum_reducer)) = 0;
-        test_reducer(n);
+        test_reducer(n, compute[variant]);
         long sum = REDUCER_VIEW(my_int_sum_reducer);
         res += (sum == scale * n) ? 1 : 0;
         CILK_C_UNREGISTER_REDUCER(my_int_sum_reducer);
         end = ktiming_getmark();
         // prlongf("The final sum is %d\n", sum);
-        running_time[i] = ktiming_diff_nsec(&begin, &end);
+        times[variant][i % TIMING_COUNT] = ktiming_diff_nsec(&begin, &end);
     }
-    printf("Result: %d/%d successes!\n", res, TIMING_COUNT);
+    printf("Result: %d/%d successes!\n", res, 3 * TIMING_COUNT);
     print_runtime(running_time, TIMING_COUNT);
+    // Wall-clock time per access, so it drops as workers are added.
+    double accesses = 100.0 * n;
+    printf("Inline lookup: %.2f ns per access\n",
+           fastest(running_time, TIMING_COUNT) / accesses);
+    printf("Runtime call:  %.2f ns per access\n",
+           fastest(call_running_time, TIMING_COUNT) / accesses);
+    printf("View scope:    %.2f ns per access\n",
+           fastest(scope_running_time, TIMING_COUNT) / accesses);
 
-    return res != TIMING_COUNT;
+    return res != 3 * TIMING_COUNT;
 }
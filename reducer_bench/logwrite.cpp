@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sstream>
+#include <string>
+#include <cilk/cilk.h>
+#include <cilk/reducer_ostream.h>
+
+extern "C" {
+#include "ktiming.h"
+}
+
+// Ostream reducer benchmark.  Writes one line per iteration of a cilk_for,
+// through a reducer on a string stream and through a reducer on a file
+// descriptor, and checks that the output is in serial order.
+
+static std::string expect;
+
+static void write_line(std::ostream &os, long i) {
+    os << "line " << i << ": " << i * i << '\n';
+}
+
+static void init(long n) {
+    std::ostringstream os;
+    for (long i = 0; i < n; i++)
+        write_line(os, i);
+    expect = os.str();
+}
+
+static bool test_ostream(long n) {
+    std::ostringstream os;
+    {
+        cilk::reducer<cilk::op_ostream> r(os);
+        cilk_for(long i = 0; i < n; i++) { write_line(*r, i); }
+    }
+    return os.str() == expect;
+}
+
+static bool test_fd(long n) {
+    FILE *file = tmpfile();
+    if (!file)
+        return false;
+    {
+        cilk::reducer<cilk::op_ostream> r(fileno(file));
+        cilk_for(long i = 0; i < n; i++) { write_line(*r, i); }
+    }
+    // The reducer wrote through the descriptor, behind the FILE's back.
+    std::string out(expect.size() + 1, '\0');
+    size_t len = (size_t)pread(fileno(file), &out[0], out.size(), 0);
+    fclose(file);
+    return len == expect.size() &&
+           memcmp(out.data(), expect.data(), len) == 0;
+}
+
+static int res, runs;
+
+static void run(const char *name, bool (*test)(long), long n) {
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+
+    for (int i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        res += test(n) ? 1 : 0;
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    runs += TIMING_COUNT;
+    printf("%s:\n", name);
+    print_runtime(running_time, TIMING_COUNT);
+}
+
+int main(int argc, const char **args) {
+    long n;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: logwrite [<cilk-options>] <n>\n");
+        exit(1);
+    }
+
+    n = atol(args[1]);
+    if (n < 1) {
+        fprintf(stderr, "logwrite: n must be positive\n");
+        exit(1);
+    }
+
+    init(n);
+
+    run("ostream", test_ostream, n);
+    run("file descriptor", test_fd, n);
+
+    printf("Result: %d/%d successes!\n", res, runs);
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <cilk/cilk.h>
+#include <cilk/reducer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ktiming.h"
+
+// Large merge benchmark.  Many reducers are active at once and every leaf
+// updates all of them, so each merge of two reducer maps performs one
+// reduction per reducer.  Merges with at least CILK_MERGE_THRESHOLD
+// reductions are shared with idle workers; compare against a run with
+// CILK_MERGE_THRESHOLD=-1.
+
+#define MAX_REDUCERS 16384
+#define WIDTH 8
+
+typedef struct {
+    long x[WIDTH];
+} vec;
+
+void identity_vec(void *reducer, void *v) {
+    for (int k = 0; k < WIDTH; k++)
+        ((vec *)v)->x[k] = 0;
+}
+
+void reduce_vec(void *reducer, void *left, void *right) {
+    for (int k = 0; k < WIDTH; k++)
+        ((vec *)left)->x[k] += ((vec *)right)->x[k];
+}
+
+typedef CILK_C_DECLARE_REDUCER(vec) vec_sum_reducer;
+
+static vec_sum_reducer sums[MAX_REDUCERS];
+static int nreducers;
+
+void spawn_tree(int depth, long leaf) {
+    if (depth == 0) {
+        for (int j = 0; j < nreducers; j++) {
+            vec *v = &REDUCER_VIEW(sums[j]);
+            for (int k = 0; k < WIDTH; k++)
+                v->x[k] += leaf + j + k;
+        }
+        return;
+    }
+    cilk_spawn spawn_tree(depth - 1, 2 * leaf);
+    spawn_tree(depth - 1, 2 * leaf + 1);
+    cilk_sync;
+}
+
+int main(int argc, const char **args) {
+    int i;
+    int depth, res = 0;
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr,
+                "Usage: manymerge [<cilk-options>] <depth> [<reducers>]\n");
+        exit(1);
+    }
+
+    depth = atoi(args[1]);
+    nreducers = argc == 3 ? atoi(args[2]) : 4096;
+    if (nreducers < 1 || nreducers > MAX_REDUCERS) {
+        fprintf(stderr, "manymerge: reducers must be 1 to %d\n",
+                MAX_REDUCERS);
+        exit(1);
+    }
+    long leaves = 1L << depth;
+
+    vec_sum_reducer init = CILK_C_INIT_REDUCER(vec, reduce_vec, identity_vec,
+                                               0 /* no destructor */, {{0}});
+    for (int j = 0; j < nreducers; j++)
+        sums[j] = init;
+
+    for (i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        for (int j = 0; j < nreducers; j++) {
+            CILK_C_REGISTER_REDUCER(sums[j]);
+            identity_vec(NULL, &REDUCER_VIEW(sums[j]));
+        }
+        spawn_tree(depth, 1);
+        // Leaves are numbered leaves .. 2 * leaves - 1.
+        int ok = 1;
+        for (int j = 0; j < nreducers; j++) {
+            vec *v = &REDUCER_VIEW(sums[j]);
+            for (int k = 0; k < WIDTH; k++) {
+                long expect = leaves * (3 * leaves - 1) / 2 + leaves * (j + k);
+                if (v->x[k] != expect)
+                    ok = 0;
+            }
+        }
+        res += ok;
+        for (int j = nreducers - 1; j >= 0; j--)
+            CILK_C_UNREGISTER_REDUCER(sums[j]);
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    printf("Result: %d/%d successes!\n", res, TIMING_COUNT);
+    print_runtime(running_time, TIMING_COUNT);
+
+    return 0;
+}
@@ -22,9 +22,16 @@
 
 #include "./board.h"
 
+#include <cilk/cilk_api.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+// List nodes come from the worker-local allocator; build with
+// WORKER_MALLOC=0 to compare against malloc.
+#ifndef WORKER_MALLOC
+#define WORKER_MALLOC 1
+#endif
+
 void print_board(board_t board) {
   for (int row = 0; row < 8; row++) {
     for (int col = 0; col < 8; col++) {
@@ -36,7 +43,11 @@ void print_board(board_t board) {
 }
 
 void append_node(BoardList *board_list, board_t board) {
+#if WORKER_MALLOC
+  BoardNode *new_node = __cilkrts_worker_malloc(sizeof(BoardNode));
+#else
   BoardNode *new_node = malloc(sizeof(BoardNode));
+#endif
   if (new_node == NULL) {
     return;
   }
@@ -62,7 +73,11 @@ void delete_nodes(BoardList *board_list) {
   BoardNode *next_node = NULL;
   while (cur_node != NULL) {
     next_node = cur_node->next;
+#if WORKER_MALLOC
+    __cilkrts_worker_free(cur_node, sizeof(BoardNode));
+#else
     free(cur_node);
+#endif
     cur_node = next_node;
   }
   board_list->head = NULL;
@@ -23,8 +23,15 @@
 #include "./intersection_event_list.h"
 
 #include <assert.h>
+#include <cilk/cilk_api.h>
 #include <stdlib.h>
 
+// List nodes come from the worker-local allocator; build with
+// WORKER_MALLOC=0 to compare against malloc.
+#ifndef WORKER_MALLOC
+#define WORKER_MALLOC 1
+#endif
+
 int IntersectionEventNode_compareData(IntersectionEventNode* node1,
                                       IntersectionEventNode* node2) {
   if (compareLines(node1->l1, node2->l1) < 0) {
@@ -74,7 +81,12 @@ void IntersectionEventList_appendNode(
     IntersectionType intersectionType) {
   assert(compareLines(l1, l2) < 0);
 
+#if WORKER_MALLOC
+  IntersectionEventNode* newNode =
+      __cilkrts_worker_malloc(sizeof(IntersectionEventNode));
+#else
   IntersectionEventNode* newNode = malloc(sizeof(IntersectionEventNode));
+#endif
   if (newNode == NULL) {
     return;
   }
@@ -98,7 +110,11 @@ void IntersectionEventList_deleteNodes(
   IntersectionEventNode* nextNode = NULL;
   while (curNode != NULL) {
     nextNode = curNode->next;
+#if WORKER_MALLOC
+    __cilkrts_worker_free(curNode, sizeof(IntersectionEventNode));
+#else
     free(curNode);
+#endif
     curNode = nextNode;
   }
   intersectionEventList->head = NULL;
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <cilk/cilk.h>
+#include <cilk/reducer_min_max.h>
+#include <cilk/reducer_opadd.h>
+#include <cilk/reducer_opxor.h>
+
+extern "C" {
+#include "ktiming.h"
+}
+
+// Range update benchmark.  Each test reduces the same array twice, once
+// with a per-element update in every iteration of a cilk_for, and once
+// with a cilk_for over blocks that each make a single range update.
+
+#define BLOCK 4096
+
+typedef unsigned long word;
+
+static long *data;
+static long expect_sum, expect_min;
+static word expect_xor;
+static long expect_max_index;
+
+static long key(long i) {
+    return (long)(((word)i * 0x9E3779B97F4A7C15UL) >> 40);
+}
+
+static void init(long n) {
+    data = (long *)malloc(n * sizeof(long));
+    for (long i = 0; i < n; i++)
+        data[i] = key(i);
+    expect_sum = 0;
+    expect_xor = 0;
+    expect_min = data[0];
+    expect_max_index = 0;
+    for (long i = 0; i < n; i++) {
+        expect_sum += data[i];
+        expect_xor ^= (word)data[i];
+        if (data[i] < expect_min)
+            expect_min = data[i];
+        if (data[expect_max_index] < data[i])
+            expect_max_index = i;
+    }
+}
+
+static long blocks(long n) { return (n + BLOCK - 1) / BLOCK; }
+
+static long block_end(long b, long n) {
+    return (b + 1) * BLOCK < n ? (b + 1) * BLOCK : n;
+}
+
+static bool test_add(long n) {
+    cilk::reducer<cilk::op_add<long> > r;
+    cilk_for(long i = 0; i < n; i++) { *r += data[i]; }
+    return r.get_value() == expect_sum;
+}
+
+static bool test_add_range(long n) {
+    cilk::reducer<cilk::op_add<long> > r;
+    cilk_for(long b = 0; b < blocks(n); b++) {
+        r->add_range(data + b * BLOCK, data + block_end(b, n));
+    }
+    return r.get_value() == expect_sum;
+}
+
+static bool test_xor(long n) {
+    cilk::reducer<cilk::op_xor<word> > r;
+    cilk_for(long i = 0; i < n; i++) { *r ^= (word)data[i]; }
+    return r.get_value() == expect_xor;
+}
+
+static bool test_xor_range(long n) {
+    cilk::reducer<cilk::op_xor<word> > r;
+    const word *words = (const word *)data;
+    cilk_for(long b = 0; b < blocks(n); b++) {
+        r->xor_range(words + b * BLOCK, words + block_end(b, n));
+    }
+    return r.get_value() == expect_xor;
+}
+
+static bool test_min(long n) {
+    cilk::reducer<cilk::op_min<long> > r;
+    cilk_for(long i = 0; i < n; i++) { r->calc_min(data[i]); }
+    return r.get_value() == expect_min;
+}
+
+static bool test_min_range(long n) {
+    cilk::reducer<cilk::op_min<long> > r;
+    cilk_for(long b = 0; b < blocks(n); b++) {
+        r->calc_min_range(data + b * BLOCK, data + block_end(b, n));
+    }
+    return r.get_value() == expect_min;
+}
+
+static bool test_max_index(long n) {
+    cilk::reducer<cilk::op_max_index<long, long> > r;
+    cilk_for(long i = 0; i < n; i++) { r->calc_max(i, data[i]); }
+    return r.get_value().first == expect_max_index;
+}
+
+static bool test_max_index_range(long n) {
+    cilk::reducer<cilk::op_max_index<long, long> > r;
+    cilk_for(long b = 0; b < blocks(n); b++) {
+        r->calc_max_range(data + b * BLOCK, data + block_end(b, n), b * BLOCK);
+    }
+    return r.get_value().first == expect_max_index;
+}
+
+static int res, runs;
+
+static void run(const char *name, bool (*test)(long), long n) {
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+
+    for (int i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        res += test(n) ? 1 : 0;
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    runs += TIMING_COUNT;
+    printf("%s:\n", name);
+    print_runtime(running_time, TIMING_COUNT);
+}
+
+int main(int argc, const char **args) {
+    long n;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: rangesum [<cilk-options>] <n>\n");
+        exit(1);
+    }
+
+    n = atol(args[1]);
+    if (n < 1) {
+        fprintf(stderr, "rangesum: n must be positive\n");
+        exit(1);
+    }
+
+    init(n);
+
+    run("add", test_add, n);
+    run("add_range", test_add_range, n);
+    run("xor", test_xor, n);
+    run("xor_range", test_xor_range, n);
+    run("calc_min", test_min, n);
+    run("calc_min_range", test_min_range, n);
+    run("calc_max index", test_max_index, n);
+    run("calc_max_range index", test_max_index_range, n);
+
+    printf("Result: %d/%d successes!\n", res, runs);
+
+    free(data);
+    return 0;
+}
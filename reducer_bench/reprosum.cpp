@@ -0,0 +1,96 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cilk/cilk.h>
+#include <cilk/reducer_opadd.h>
+#include <cilk/reducer_opadd_reproducible.h>
+
+extern "C" {
+#include "ktiming.h"
+}
+
+// Reproducible sum benchmark.  Sums the same doubles, of mixed signs and
+// magnitudes, with op_add and with op_add_reproducible.  The reproducible
+// sum must match the serial exact sum bit for bit; the plain sum need only
+// be close to it.
+
+static double *data;
+static double exact, magnitude;
+
+static double value(long i) {
+    unsigned long x = (unsigned long)i * 0x9E3779B97F4A7C15UL;
+    double frac = (double)(x >> 11) / (double)(1UL << 53) - 0.5;
+    return ldexp(frac, (int)(x % 61) - 30);
+}
+
+static void init(long n) {
+    data = (double *)malloc(n * sizeof(double));
+    cilk::op_add_reproducible_view<double> sum;
+    magnitude = 0;
+    for (long i = 0; i < n; i++) {
+        data[i] = value(i);
+        sum += data[i];
+        magnitude += fabs(data[i]);
+    }
+    exact = sum.view_get_value();
+}
+
+static bool test_add(long n) {
+    cilk::reducer<cilk::op_add<double> > r;
+    cilk_for(long i = 0; i < n; i++) { *r += data[i]; }
+    return fabs(r.get_value() - exact) <= 1e-9 * magnitude;
+}
+
+static bool test_reproducible(long n) {
+    cilk::reducer<cilk::op_add_reproducible<double> > r;
+    cilk_for(long i = 0; i < n; i++) { *r += data[i]; }
+    double sum = r.get_value();
+    return memcmp(&sum, &exact, sizeof sum) == 0;
+}
+
+static int res, runs;
+
+static uint64_t run(const char *name, bool (*test)(long), long n) {
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+    uint64_t total = 0;
+
+    for (int i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        res += test(n) ? 1 : 0;
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+        total += running_time[i];
+    }
+    runs += TIMING_COUNT;
+    printf("%s:\n", name);
+    print_runtime(running_time, TIMING_COUNT);
+    return total;
+}
+
+int main(int argc, const char **args) {
+    long n;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: reprosum [<cilk-options>] <n>\n");
+        exit(1);
+    }
+
+    n = atol(args[1]);
+    if (n < 1) {
+        fprintf(stderr, "reprosum: n must be positive\n");
+        exit(1);
+    }
+
+    init(n);
+
+    uint64_t plain = run("op_add", test_add, n);
+    uint64_t repro = run("op_add_reproducible", test_reproducible, n);
+
+    printf("Result: %d/%d successes!\n", res, runs);
+    printf("Overhead of reproducible sum: %.2fx\n", (double)repro / plain);
+
+    free(data);
+    return 0;
+}
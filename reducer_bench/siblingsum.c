@@ -0,0 +1,83 @@
+#include <cilk/cilk.h>
+#include <cilk/reducer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ktiming.h"
+
+// Wide spawn benchmark.  One frame spawns many children in a loop before
+// syncing, so many sibling maps return to the same parent.  The eager
+// protocol reduces each returning map with its neighbors; with
+// DEFERRED_REDUCE set in cilk/sentinel.h the maps are chained and reduced
+// once at the sync.  Build the runtime both ways to compare.
+
+#define NREDUCERS 16
+
+void identity_longsum(void *reducer, void *sum) { *((long *)sum) = 0; }
+
+void reduce_longsum(void *reducer, void *left, void *right) {
+    *((long *)left) += *((long *)right);
+}
+
+typedef CILK_C_DECLARE_REDUCER(long) long_sum_reducer;
+
+static long_sum_reducer sums[NREDUCERS];
+
+void add_range(long begin, long end) {
+    for (long i = begin; i < end; i++)
+        REDUCER_VIEW(sums[i % NREDUCERS]) += i;
+}
+
+void spawn_children(long n, long children) {
+    for (long c = 0; c < children; c++)
+        cilk_spawn add_range(n * c / children, n * (c + 1) / children);
+    cilk_sync;
+}
+
+int main(int argc, const char **args) {
+    int i;
+    long n, children;
+    int res = 0;
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr,
+                "Usage: siblingsum [<cilk-options>] <n> [<children>]\n");
+        exit(1);
+    }
+
+    n = atol(args[1]);
+    children = argc == 3 ? atol(args[2]) : 4096;
+    if (n < 1 || children < 1) {
+        fprintf(stderr, "siblingsum: n and children must be positive\n");
+        exit(1);
+    }
+
+    long_sum_reducer init =
+        CILK_C_INIT_REDUCER(long, reduce_longsum, identity_longsum,
+                            0 /* no destructor */, 0);
+    for (int j = 0; j < NREDUCERS; j++)
+        sums[j] = init;
+
+    for (i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        for (int j = 0; j < NREDUCERS; j++) {
+            CILK_C_REGISTER_REDUCER(sums[j]);
+            REDUCER_VIEW(sums[j]) = 0;
+        }
+        spawn_children(n, children);
+        long total = 0;
+        for (int j = 0; j < NREDUCERS; j++)
+            total += REDUCER_VIEW(sums[j]);
+        res += total == n * (n - 1) / 2;
+        for (int j = NREDUCERS - 1; j >= 0; j--)
+            CILK_C_UNREGISTER_REDUCER(sums[j]);
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    printf("Result: %d/%d successes!\n", res, TIMING_COUNT);
+    print_runtime(running_time, TIMING_COUNT);
+
+    return 0;
+}
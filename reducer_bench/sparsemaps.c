@@ -0,0 +1,120 @@
+#include <cilk/cilk.h>
+#include <cilk/reducer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "ktiming.h"
+
+// Sparse reducer map benchmark.  Many reducers are registered, but each
+// leaf updates only a few of them, spread over the whole range of reducer
+// IDs, so the reducer maps of stolen strands hold few views with high IDs.
+// Run with CILK_REDUCER_MAP=spa and CILK_REDUCER_MAP=hash to compare the
+// two maps as the number of reducers grows.
+
+#define MAX_REDUCERS 65536
+#define TOUCH 8 // reducers updated by each leaf
+
+void identity_longsum(void *reducer, void *sum) { *((long *)sum) = 0; }
+
+void reduce_longsum(void *reducer, void *left, void *right) {
+    *((long *)left) += *((long *)right);
+}
+
+typedef CILK_C_DECLARE_REDUCER(long) long_sum_reducer;
+
+static long_sum_reducer sums[MAX_REDUCERS];
+static long expect[MAX_REDUCERS];
+static int nreducers;
+
+static int touched(long leaf, int k) {
+    return (leaf * 7919 + (long)k * (nreducers / TOUCH + 1)) % nreducers;
+}
+
+void spawn_tree(int depth, long leaf) {
+    if (depth == 0) {
+        for (int k = 0; k < TOUCH; k++)
+            REDUCER_VIEW(sums[touched(leaf, k)]) += leaf;
+        return;
+    }
+    cilk_spawn spawn_tree(depth - 1, 2 * leaf);
+    spawn_tree(depth - 1, 2 * leaf + 1);
+    cilk_sync;
+}
+
+static int run(int depth) {
+    long leaves = 1L << depth;
+    // Leaves are numbered leaves .. 2 * leaves - 1.
+    for (int j = 0; j < nreducers; j++)
+        expect[j] = 0;
+    for (long leaf = leaves; leaf < 2 * leaves; leaf++)
+        for (int k = 0; k < TOUCH; k++)
+            expect[touched(leaf, k)] += leaf;
+
+    for (int j = 0; j < nreducers; j++) {
+        CILK_C_REGISTER_REDUCER(sums[j]);
+        REDUCER_VIEW(sums[j]) = 0;
+    }
+    spawn_tree(depth, 1);
+    int ok = 1;
+    for (int j = 0; j < nreducers; j++)
+        if (REDUCER_VIEW(sums[j]) != expect[j])
+            ok = 0;
+    for (int j = nreducers - 1; j >= 0; j--)
+        CILK_C_UNREGISTER_REDUCER(sums[j]);
+    return ok;
+}
+
+int main(int argc, const char **args) {
+    int i;
+    int depth, max_reducers, res = 0, runs = 0;
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr,
+                "Usage: sparsemaps [<cilk-options>] <depth> [<reducers>]\n");
+        exit(1);
+    }
+
+    depth = atoi(args[1]);
+    max_reducers = argc == 3 ? atoi(args[2]) : 4096;
+    if (depth < 0 || max_reducers < 1 || max_reducers > MAX_REDUCERS) {
+        fprintf(stderr,
+                "sparsemaps: depth must not be negative and reducers must "
+                "be 1 to %d\n",
+                MAX_REDUCERS);
+        exit(1);
+    }
+
+    long_sum_reducer init =
+        CILK_C_INIT_REDUCER(long, reduce_longsum, identity_longsum,
+                            0 /* no destructor */, 0);
+    for (int j = 0; j < MAX_REDUCERS; j++)
+        sums[j] = init;
+
+    const char *map = getenv("CILK_REDUCER_MAP");
+    printf("Reducer map: %s\n", map ? map : "default");
+
+    // Each count of reducers is 16 times the last, up to the maximum.
+    for (nreducers = max_reducers; nreducers / 16 > 0;)
+        nreducers /= 16;
+    for (; nreducers <= max_reducers; nreducers *= 16) {
+        for (i = 0; i < TIMING_COUNT; i++) {
+            begin = ktiming_getmark();
+            res += run(depth);
+            end = ktiming_getmark();
+            running_time[i] = ktiming_diff_nsec(&begin, &end);
+        }
+        runs += TIMING_COUNT;
+        printf("%d reducers:\n", nreducers);
+        print_runtime(running_time, TIMING_COUNT);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("Maximum resident set: %ld KiB\n", usage.ru_maxrss);
+    printf("Result: %d/%d successes!\n", res, runs);
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <cilk/cilk.h>
+#include <cilk/reducer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ktiming.h"
+
+// Stress test for memory that is allocated on one worker and freed on
+// another.  Every steal creates a closure and reducer views on the thief
+// that are usually destroyed by whichever worker finishes the merge.
+
+void identity_longsum(void *reducer, void *sum) { *((long *)sum) = 0; }
+
+void reduce_longsum(void *reducer, void *left, void *right) {
+    *((long *)left) += *((long *)right);
+}
+
+CILK_C_DECLARE_REDUCER(long)
+my_long_sum_reducer = CILK_C_INIT_REDUCER(long, reduce_longsum,
+                                          identity_longsum,
+                                          0 /* no destructor */, 0);
+
+CILK_C_DECLARE_REDUCER(long)
+my_long_count_reducer = CILK_C_INIT_REDUCER(long, reduce_longsum,
+                                            identity_longsum,
+                                            0 /* no destructor */, 0);
+
+void spawn_tree(int depth, long leaf) {
+    if (depth == 0) {
+        REDUCER_VIEW(my_long_sum_reducer) += leaf;
+        REDUCER_VIEW(my_long_count_reducer) += 1;
+        return;
+    }
+    cilk_spawn spawn_tree(depth - 1, 2 * leaf);
+    spawn_tree(depth - 1, 2 * leaf + 1);
+    cilk_sync;
+}
+
+int main(int argc, const char **args) {
+    int i;
+    int depth, res = 0;
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: stealfree [<cilk-options>] <depth>\n");
+        exit(1);
+    }
+
+    depth = atoi(args[1]);
+    long leaves = 1L << depth;
+
+    for (i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        CILK_C_REGISTER_REDUCER(my_long_sum_reducer);
+        CILK_C_REGISTER_REDUCER(my_long_count_reducer);
+        REDUCER_VIEW(my_long_sum_reducer) = 0;
+        REDUCER_VIEW(my_long_count_reducer) = 0;
+        spawn_tree(depth, 1);
+        long sum = REDUCER_VIEW(my_long_sum_reducer);
+        long count = REDUCER_VIEW(my_long_count_reducer);
+        // Leaves are numbered leaves .. 2 * leaves - 1.
+        if (count == leaves && sum == leaves * (3 * leaves - 1) / 2)
+            res++;
+        CILK_C_UNREGISTER_REDUCER(my_long_count_reducer);
+        CILK_C_UNREGISTER_REDUCER(my_long_sum_reducer);
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    printf("Result: %d/%d successes!\n", res, TIMING_COUNT);
+    print_runtime(running_time, TIMING_COUNT);
+
+    return 0;
+}
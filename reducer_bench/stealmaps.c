@@ -0,0 +1,87 @@
+#include <cilk/cilk.h>
+#include <cilk/reducer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ktiming.h"
+
+// Reducer map churn benchmark.  Every steal gives the thief a new reducer
+// map, and every leaf touches many reducers, so most of the time goes to
+// creating, merging, and destroying maps that each hold many views.
+
+#define MAX_REDUCERS 1024
+
+void identity_longsum(void *reducer, void *sum) { *((long *)sum) = 0; }
+
+void reduce_longsum(void *reducer, void *left, void *right) {
+    *((long *)left) += *((long *)right);
+}
+
+typedef CILK_C_DECLARE_REDUCER(long) long_sum_reducer;
+
+static long_sum_reducer sums[MAX_REDUCERS];
+static int nreducers;
+
+void spawn_tree(int depth, long leaf) {
+    if (depth == 0) {
+        for (int j = 0; j < nreducers; j++)
+            REDUCER_VIEW(sums[j]) += leaf + j;
+        return;
+    }
+    cilk_spawn spawn_tree(depth - 1, 2 * leaf);
+    spawn_tree(depth - 1, 2 * leaf + 1);
+    cilk_sync;
+}
+
+int main(int argc, const char **args) {
+    int i;
+    int depth, res = 0;
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr,
+                "Usage: stealmaps [<cilk-options>] <depth> [<reducers>]\n");
+        exit(1);
+    }
+
+    depth = atoi(args[1]);
+    nreducers = argc == 3 ? atoi(args[2]) : 64;
+    if (nreducers < 1 || nreducers > MAX_REDUCERS) {
+        fprintf(stderr, "stealmaps: reducers must be 1 to %d\n",
+                MAX_REDUCERS);
+        exit(1);
+    }
+    long leaves = 1L << depth;
+
+    long_sum_reducer init =
+        CILK_C_INIT_REDUCER(long, reduce_longsum, identity_longsum,
+                            0 /* no destructor */, 0);
+    for (int j = 0; j < nreducers; j++)
+        sums[j] = init;
+
+    for (i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        for (int j = 0; j < nreducers; j++) {
+            CILK_C_REGISTER_REDUCER(sums[j]);
+            REDUCER_VIEW(sums[j]) = 0;
+        }
+        spawn_tree(depth, 1);
+        // Leaves are numbered leaves .. 2 * leaves - 1.
+        int ok = 1;
+        for (int j = 0; j < nreducers; j++) {
+            long expect = leaves * (3 * leaves - 1) / 2 + leaves * j;
+            if (REDUCER_VIEW(sums[j]) != expect)
+                ok = 0;
+        }
+        res += ok;
+        for (int j = nreducers - 1; j >= 0; j--)
+            CILK_C_UNREGISTER_REDUCER(sums[j]);
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    printf("Result: %d/%d successes!\n", res, TIMING_COUNT);
+    print_runtime(running_time, TIMING_COUNT);
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cilk/cilk.h>
+#include <cilk/reducer_map.h>
+
+extern "C" {
+#include "ktiming.h"
+}
+
+// Word count benchmark.  Counts the words of a pseudo-random text with a
+// hash map reducer.  Word frequencies are skewed, so that a few words are
+// common to every view and many are rare.
+
+typedef cilk::op_map_merge<std::string, long> count_monoid;
+
+static std::vector<std::string> make_text(long n, unsigned vocab) {
+    std::vector<std::string> text(n);
+    for (long i = 0; i < n; i++) {
+        unsigned long x = (unsigned long)i * 0x9E3779B97F4A7C15UL;
+        unsigned r = (unsigned)((x >> 32) % vocab);
+        // Squaring the fraction r / vocab favors small word numbers.
+        unsigned w = (unsigned)((unsigned long)r * r / vocab);
+        text[i] = "w" + std::to_string(w);
+    }
+    return text;
+}
+
+static bool check(const count_monoid::value_type &counts,
+                  const std::vector<std::string> &text) {
+    std::unordered_map<std::string, long> expect;
+    for (size_t i = 0; i < text.size(); i++)
+        expect[text[i]]++;
+    if (counts.size() != expect.size())
+        return false;
+    for (auto &kv : expect) {
+        const long *c = counts.find(kv.first);
+        if (!c || *c != kv.second)
+            return false;
+    }
+    return true;
+}
+
+// The test times the loop and the final reduction, but not the check.
+
+static bool test(const std::vector<std::string> &text, uint64_t *time) {
+    clockmark_t begin = ktiming_getmark();
+    cilk::reducer<count_monoid> counts;
+    cilk_for(size_t i = 0; i < text.size(); i++) { counts->merge(text[i], 1); }
+    const count_monoid::value_type &result = counts.get_value();
+    clockmark_t end = ktiming_getmark();
+    *time = ktiming_diff_nsec(&begin, &end);
+    return check(result, text);
+}
+
+int main(int argc, const char **args) {
+    int i;
+    long n;
+    unsigned vocab;
+    int res = 0;
+    uint64_t running_time[TIMING_COUNT];
+
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: wordcount [<cilk-options>] <n> [<vocab>]\n");
+        exit(1);
+    }
+
+    n = atol(args[1]);
+    vocab = argc == 3 ? atoi(args[2]) : 100000;
+    if (n < 1 || vocab < 1) {
+        fprintf(stderr, "wordcount: n and vocab must be positive\n");
+        exit(1);
+    }
+
+    std::vector<std::string> text = make_text(n, vocab);
+
+    for (i = 0; i < TIMING_COUNT; i++)
+        res += test(text, &running_time[i]) ? 1 : 0;
+    printf("Result: %d/%d successes!\n", res, TIMING_COUNT);
+    print_runtime(running_time, TIMING_COUNT);
+
+    return 0;
+}
@@ -226,7 +226,7 @@ struct __cilkrts_worker {
     // Map from reducer names to reducer values
     cilkred_map *reducer_map;
 
-#if COMM_REDUCER && ! HASH_REDUCER
+#if COMM_REDUCER
     // Commutative reducer map
     com_cilkred_map *com_reducer_map;
 #endif
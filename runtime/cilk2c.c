@@ -40,6 +40,10 @@ unsigned __cilkrts_get_worker_number(void) {
     return default_cilkrts->exiting_worker;
 }
 
+// Return the ID of worker w, a small integer less than the number of
+// workers, for indexing worker-local data.
+unsigned __cilkrts_get_worker_id(__cilkrts_worker *w) { return w->self; }
+
 // Test if the Cilk runtime has been initialized.  This method is intended to
 // help initialization of libraries that depend on the OpenCilk runtime.
 int __cilkrts_is_initialized(void) { return NULL != default_cilkrts; }
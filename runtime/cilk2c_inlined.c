@@ -58,9 +58,6 @@ extern void inline_promote_own_deque(__cilkrts_worker *w);
 
 extern cilkred_map *install_new_reducer_map(__cilkrts_worker *w);
 
-#if HASH_REDUCER
-// Maybe nothing?
-#else
 extern
 ViewInfo * hyperlookup_slowpath(__cilkrts_hyperobject_base *key,
                           __cilkrts_worker *w,
@@ -70,7 +67,6 @@ ViewInfo * hyperlookup_slowpath(__cilkrts_hyperobject_base *key,
 #if COMM_REDUCER
 extern com_cilkred_map *install_new_com_reducer_map(__cilkrts_worker *w);
 #endif
-#endif
 
 #include "reducer/hyperlookup.c"
 #endif
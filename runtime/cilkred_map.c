@@ -1,7 +1,3 @@
-#include "cilk/sentinel.h"
-
-#if HASH_REDUCER
-#include "reducer/cilkred_map_hash.c"
-#else
+// Both reducer maps are built; CILK_REDUCER_MAP selects one at startup.
 #include "reducer/cilkred_map_spa.c"
-#endif
+#include "reducer/cilkred_map_hash.c"
@@ -41,21 +41,25 @@ static void fiber_pool_stat_init(struct cilk_fiber_pool *pool) {
     pool->stats.in_use = 0;
     pool->stats.max_in_use = 0;
     pool->stats.max_free = 0;
+    pool->stats.trimmed = 0;
 }
 
-#define POOL_FMT "size %3u, %4d used %4d max used %4u max free"
+#define POOL_FMT                                                               \
+    "size %3u, %4d used %4d max used %4u max free %4u trimmed"
 
 static void fiber_pool_stat_print_worker(__cilkrts_worker *w, void *data) {
     FILE *fp = (FILE *)data;
     fprintf(fp, "[W%02" PRIu32 "] " POOL_FMT "\n", w->self,
             w->l->fiber_pool.size, w->l->fiber_pool.stats.in_use,
-            w->l->fiber_pool.stats.max_in_use, w->l->fiber_pool.stats.max_free);
+            w->l->fiber_pool.stats.max_in_use, w->l->fiber_pool.stats.max_free,
+            w->l->fiber_pool.stats.trimmed);
 }
 
 static void fiber_pool_stat_print(struct global_state *g) {
     fprintf(stderr, "\nFIBER POOL STATS\n[G  ] " POOL_FMT "\n",
             g->fiber_pool.size, g->fiber_pool.stats.in_use,
-            g->fiber_pool.stats.max_in_use, g->fiber_pool.stats.max_free);
+            g->fiber_pool.stats.max_in_use, g->fiber_pool.stats.max_free,
+            g->fiber_pool.stats.trimmed);
     for_each_worker(g, &fiber_pool_stat_print_worker, stderr);
     fprintf(stderr, "\n");
 }
@@ -319,6 +323,47 @@ void cilk_fiber_pool_per_worker_destroy(__cilkrts_worker *w) {
     fiber_pool_destroy(pool);
 }
 
+/**
+ * Give free fibers beyond the initial batch of worker w back to the
+ * global pool.  Called by w between Cilkified regions.
+ */
+void cilk_fiber_pool_per_worker_trim(__cilkrts_worker *w) {
+    struct cilk_fiber_pool *pool = &(w->l->fiber_pool);
+    unsigned int keep = pool->capacity / BATCH_FRACTION;
+    if (pool->size > keep) {
+        pool->stats.trimmed += pool->size - keep;
+        fiber_pool_free_batch(w, pool, pool->size - keep);
+    }
+}
+
+/**
+ * Free the fibers in the global pool beyond the trim_fibers high-water
+ * mark.  Returns the number of stack bytes released to the system.
+ */
+size_t cilk_fiber_pool_global_trim(__cilkrts_worker *w) {
+    struct cilk_fiber_pool *pool = &(w->g->fiber_pool);
+    unsigned int keep = w->g->options.trim_fibers;
+    size_t released = 0;
+    while (true) {
+        struct cilk_fiber *fiber = NULL;
+        fiber_pool_lock(w, pool);
+        if (pool->size > keep) {
+            fiber = pool->fibers[--pool->size];
+            pool->stats.trimmed++;
+        }
+        fiber_pool_unlock(w, pool);
+        if (!fiber)
+            break;
+        // Unmap the stack without holding the lock.
+        cilk_fiber_deallocate(w, fiber);
+        released += pool->stack_size;
+    }
+    if (released)
+        cilkrts_alert(FIBER_SUMMARY, w, "Returned %zu bytes of fibers",
+                      released);
+    return released;
+}
+
 /**
  * Allocate a fiber from this pool; if this pool is empty,
  * allocate a batch of fibers from the parent pool (or system).
@@ -1,3 +1,4 @@
+#include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
@@ -20,6 +21,9 @@ struct cilk_fiber {
     __cilkrts_worker *owner; // worker using this fiber
 };
 
+static_assert(sizeof(struct cilk_fiber) == CILK_FIBER_SIZE,
+              "CILK_FIBER_SIZE does not match struct cilk_fiber");
+
 #ifndef MAP_GROWSDOWN
 /* MAP_GROWSDOWN is implied on BSD */
 #define MAP_GROWSDOWN 0
@@ -17,6 +17,7 @@ struct fiber_pool_stats {
     int in_use;     // number of fibers allocated - freed from / into the pool
     int max_in_use; // high watermark for in_use
     unsigned max_free; // high watermark for number of free fibers in the pool
+    unsigned trimmed;  // free fibers given up by trimming
 };
 
 struct cilk_fiber_pool {
@@ -35,6 +36,9 @@ struct cilk_fiber_pool {
 
 struct cilk_fiber; // opaque type
 
+/* Size of the opaque struct cilk_fiber, for internal malloc size classes. */
+#define CILK_FIBER_SIZE (5 * sizeof(void *))
+
 //===============================================================
 // Supported functions
 //===============================================================
@@ -89,6 +93,8 @@ CHEETAH_INTERNAL void cilk_fiber_pool_global_destroy(global_state *g);
 CHEETAH_INTERNAL void cilk_fiber_pool_per_worker_init(__cilkrts_worker *w);
 CHEETAH_INTERNAL void cilk_fiber_pool_per_worker_terminate(__cilkrts_worker *w);
 CHEETAH_INTERNAL void cilk_fiber_pool_per_worker_destroy(__cilkrts_worker *w);
+CHEETAH_INTERNAL void cilk_fiber_pool_per_worker_trim(__cilkrts_worker *w);
+CHEETAH_INTERNAL size_t cilk_fiber_pool_global_trim(__cilkrts_worker *w);
 
 // allocate / deallocate one fiber from / back to OS
 CHEETAH_INTERNAL
@@ -32,7 +32,6 @@ static global_state *global_state_allocate() {
         __alignof(global_state), sizeof(global_state));
     memset(g, 0, sizeof *g);
 
-    cilk_mutex_init(&g->im_lock);
     cilk_mutex_init(&g->print_lock);
 
     // TODO: Convert to cilk_* equivalents
@@ -85,6 +84,20 @@ void set_force_reduce(global_state *g, unsigned int force_reduce) {
     g->options.force_reduce = force_reduce;
 }
 
+static void set_reducer_map(global_state *g, const char *name) {
+    CILK_ASSERT_G(!g->workers_started);
+    if (strcmp(name, "spa") == 0) {
+        g->options.reducer_map = REDUCER_MAP_SPA;
+    } else if (strcmp(name, "hash") == 0) {
+        g->options.reducer_map = REDUCER_MAP_HASH;
+    } else {
+        fprintf(stderr,
+                "CILK_REDUCER_MAP must be \"spa\" or \"hash\", not \"%s\".\n"
+                "Using the default reducer map.\n",
+                name);
+    }
+}
+
 // Set global RTS options from environment variables.
 static void parse_rts_environment(global_state *g) {
     size_t stacksize = env_get_int("CILK_STACKSIZE");
@@ -96,6 +109,32 @@ static void parse_rts_environment(global_state *g) {
     unsigned int fiber_pool_cap = env_get_int("CILK_FIBER_POOL");
     if (fiber_pool_cap > 0)
         set_fiber_pool_cap(g, fiber_pool_cap);
+    // Memory is kept between Cilkified regions up to these limits.  A
+    // negative value keeps nothing.  Setting either limit also trims at
+    // the end of every region; otherwise only __cilkrts_trim does.
+    long trim_memory = env_get_int("CILK_TRIM_MEMORY");
+    if (trim_memory != 0) {
+        g->options.trim_memory = trim_memory < 0 ? 0 : trim_memory;
+        g->options.trim_regions = 1;
+    }
+    long trim_fibers = env_get_int("CILK_TRIM_FIBERS");
+    if (trim_fibers != 0) {
+        g->options.trim_fibers = trim_fibers < 0 ? 0 : trim_fibers;
+        g->options.trim_regions = 1;
+    }
+    // Merges with at least this many reductions are shared with idle
+    // workers, which then run reduce functions under their own worker
+    // state.  Off by default; a negative value also keeps every merge
+    // serial.
+    long merge_threshold = env_get_int("CILK_MERGE_THRESHOLD");
+    if (merge_threshold != 0)
+        g->options.merge_threshold = merge_threshold < 0 ? 0 : merge_threshold;
+    // Reducer maps are sparse accumulators indexed by reducer ID, or hash
+    // tables, which use less memory when each strand touches few of many
+    // reducers.
+    const char *reducer_map = getenv("CILK_REDUCER_MAP");
+    if (reducer_map)
+        set_reducer_map(g, reducer_map);
 
     long proc_override = env_get_int("CILK_NWORKERS");
     if (g->options.nproc == 0) {
@@ -19,6 +19,11 @@ struct __cilkrts_worker;
 struct reducer_id_manager;
 struct Closure;
 
+enum reducer_map_kind {
+    REDUCER_MAP_SPA,  ///< Sparse accumulator indexed by reducer ID
+    REDUCER_MAP_HASH, ///< Open-addressing hash table keyed by reducer ID
+};
+
 // clang-format off
 #define DEFAULT_OPTIONS                                            \
     {                                                              \
@@ -28,6 +33,11 @@ struct Closure;
         DEFAULT_DEQ_DEPTH,      /* num of entries in deque */      \
         DEFAULT_FIBER_POOL_CAP, /* alloc_batch_size */             \
         DEFAULT_FORCE_REDUCE,   /* whether to force self steal and reduce */\
+        DEFAULT_TRIM_MEMORY,    /* free internal memory kept per node */   \
+        DEFAULT_TRIM_FIBERS,    /* free fibers kept in the global pool */  \
+        DEFAULT_TRIM_REGIONS,   /* whether to trim at the end of regions */\
+        DEFAULT_MERGE_THRESHOLD, /* reductions before sharing a merge */   \
+        DEFAULT_REDUCER_MAP,    /* implementation of reducer maps */       \
     }
 // clang-format on
 
@@ -38,6 +48,11 @@ struct rts_options {
     unsigned int deqdepth;       /* can be set via env variable CILK_DEQDEPTH */
     unsigned int fiber_pool_cap; /* can be set via env variable CILK_FIBER_POOL */
     unsigned int force_reduce;   /* can be set via env variable CILK_FORCE_REDUCE */
+    size_t trim_memory;          /* can be set via env variable CILK_TRIM_MEMORY */
+    unsigned int trim_fibers;    /* can be set via env variable CILK_TRIM_FIBERS */
+    unsigned int trim_regions;   /* set if either trim limit is set */
+    unsigned int merge_threshold; /* can be set via env variable CILK_MERGE_THRESHOLD */
+    unsigned int reducer_map;    /* can be set via env variable CILK_REDUCER_MAP */
 };
 
 struct global_state {
@@ -52,9 +67,8 @@ struct global_state {
     struct Closure *root_closure;
 
     struct cilk_fiber_pool fiber_pool __attribute__((aligned(CILK_CACHE_LINE)));
-    struct global_im_pool im_pool __attribute__((aligned(CILK_CACHE_LINE)));
-    struct cilk_im_desc im_desc __attribute__((aligned(CILK_CACHE_LINE)));
-    cilk_mutex im_lock; // lock for accessing global im_desc
+    struct global_im_pool *im_pools; // internal malloc, one per NUMA node
+    unsigned int im_num_nodes;
 
     volatile bool workers_started;
     volatile bool root_closure_initialized;
@@ -45,6 +45,9 @@ static local_state *worker_local_init(global_state *g) {
         l->rts_ctx[i] = NULL;
     }
     l->fiber_to_free = NULL;
+    l->map_cache = NULL;
+    l->map_cache_size = 0;
+    l->id_cache_size = 0;
     l->state = WORKER_IDLE;
     l->lock_wait = false;
     l->provably_good_steal = false;
@@ -82,7 +85,7 @@ static void workers_init(global_state *g) {
         atomic_store_explicit(&w->exc, init, memory_order_relaxed);
         w->current_stack_frame = NULL;
         w->reducer_map = NULL;
-#if COMM_REDUCER && ! HASH_REDUCER
+#if COMM_REDUCER
         w->com_reducer_map = NULL;
 #endif        // initialize internal malloc first
         cilk_internal_malloc_per_worker_init(w);
@@ -90,6 +93,34 @@ static void workers_init(global_state *g) {
     }
 }
 
+// Return memory cached by the runtime beyond its high-water marks to the
+// system.  Worker w must not be running Cilk code.  Other workers are
+// only touched through the locked global pools.
+static size_t trim_global_pools(__cilkrts_worker *w) {
+    return cilk_fiber_pool_global_trim(w) +
+           cilk_internal_malloc_global_trim(w->g);
+}
+
+size_t __cilkrts_trim(void) {
+    global_state *g = default_cilkrts;
+    // Workers are running Cilk code if the caller is one of them.
+    if (!g || __cilkrts_get_tls_worker())
+        return 0;
+    size_t released = 0;
+    // Holding the lock keeps a Cilkified region from starting, so the
+    // worker that exited the last one stays idle.
+    pthread_mutex_lock(&(g->cilkified_lock));
+    if (!atomic_load_explicit(&g->cilkified, memory_order_acquire)) {
+        __cilkrts_worker *w = g->workers[g->exiting_worker];
+        cilk_fiber_pool_per_worker_trim(w);
+        cilkred_map_cache_drain(w);
+        cilk_internal_malloc_per_worker_trim(w);
+        released = trim_global_pools(w);
+    }
+    pthread_mutex_unlock(&(g->cilkified_lock));
+    return released;
+}
+
 static void *scheduler_thread_proc(void *arg) {
     __cilkrts_worker *w = (__cilkrts_worker *)arg;
     cilkrts_alert(BOOT, w, "scheduler_thread_proc");
@@ -112,9 +143,6 @@ static void *scheduler_thread_proc(void *arg) {
             return 0;
         }
 
-        /* TODO: Maybe import reducers here?  They must be imported
-           before user code runs. */
-
         // Start the new Cilkified region using the last worker that finished a
         // Cilkified region.  This approach ensures that the new Cilkified
         // region starts on an available worker with the worker state that was
@@ -122,6 +150,7 @@ static void *scheduler_thread_proc(void *arg) {
         // Such operations, for example might have updated the left-most view of
         // a reducer.
         if (self == w->g->exiting_worker) {
+            reducers_enter(w);
             worker_scheduler(w, w->g->root_closure);
         } else {
             worker_scheduler(w, NULL);
@@ -133,7 +162,14 @@ static void *scheduler_thread_proc(void *arg) {
         // Cilkified region, including all updates to reducers.  Wait for that
         // worker to exit the work-stealing loop, and use it to wake-up the
         // original Cilkifying thread.
+        // If the program set a trim limit, keep only what the next region
+        // is likely to need.  The exiting worker trims the shared pools
+        // before the Cilkifying thread resumes and may use its state.
+        if (w->g->options.trim_regions)
+            cilk_fiber_pool_per_worker_trim(w);
         if (self == w->g->exiting_worker) {
+            if (w->g->options.trim_regions)
+                trim_global_pools(w);
             // Mark the computation as no longer cilkified, to signal the thread
             // that originally cilkified the execution.
             pthread_mutex_lock(&(w->g->cilkified_lock));
@@ -369,8 +405,11 @@ void invoke_cilkified_root(global_state *g, __cilkrts_stack_frame *sf) {
     // flags:
 
     // Set g->cilkified = 1, so the Cilkifying thread will wait for the
-    // Cilkified region to finish.
+    // Cilkified region to finish.  The lock keeps the region from starting
+    // while __cilkrts_trim uses the exiting worker.
+    pthread_mutex_lock(&(g->cilkified_lock));
     atomic_store_explicit(&g->cilkified, 1, memory_order_release);
+    pthread_mutex_unlock(&(g->cilkified_lock));
     // Set g->done = 0, so Cilk workers will continue trying to steal.
     atomic_store_explicit(&g->done, 0, memory_order_release);
     // Set g->start = 1 to unleash workers to enter the work-stealing loop.
@@ -483,6 +522,13 @@ static void worker_terminate(__cilkrts_worker *w, void *data) {
     if (rm) {
         cilkred_map_destroy_map(w, rm);
     }
+    cilkred_map_cache_drain(w);
+#if COMM_REDUCER
+    if (w->com_reducer_map) {
+        com_cilkred_map_free(w, w->com_reducer_map);
+        w->com_reducer_map = NULL;
+    }
+#endif
     cilk_internal_malloc_per_worker_terminate(w); // internal malloc last
 }
 
@@ -506,7 +552,7 @@ static void wrap_fiber_pool_destroy(__cilkrts_worker *w, void *data) {
 static void workers_deinit(global_state *g) {
     cilkrts_alert(BOOT, NULL, "(workers_deinit) Clean up workers");
 
-    long allocations[NUM_BUCKETS] = {0, 0, 0, 0};
+    long allocations[NUM_BUCKETS] = {0};
 
     for_each_worker_rev(g, sum_allocations, allocations);
 
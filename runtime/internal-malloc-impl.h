@@ -1,27 +1,31 @@
 #ifndef _INTERAL_MALLOC_IMPL_H
 #define _INTERAL_MALLOC_IMPL_H
 
+#include <stdatomic.h>
+#include <stdbool.h>
+
 #include "debug.h"
+#include "mutex.h"
 #include "rts-config.h"
+#include "types.h"
 
 #include "internal-malloc.h"
 
-#define NUM_BUCKETS 7
+/* One slab per fixed size object type plus generic cache line multiples. */
+#define NUM_TAG_BUCKETS 3
+#define NUM_GENERIC_BUCKETS 10
+#define NUM_BUCKETS (NUM_TAG_BUCKETS + NUM_GENERIC_BUCKETS)
 #define NUM_IM_CALLERS 4
 
-/* struct for managing global memory pool; each memory block in mem_list starts
-   out with size INTERNAL_MALLOC_CHUNK.  We will allocate small pieces off the
-   memory block and free the pieces into per-worker im_descriptor free list. */
-struct global_im_pool {
-    char *mem_begin; // beginning of the free memory block that we are using
-    char *mem_end;   // end of the free memory block that we are using
-    char **mem_list; // list of memory blocks obtained from system
-    unsigned mem_list_index; // index to the current mem block in use
-    unsigned mem_list_size;  // length of the mem_list
-    size_t num_global_malloc;
-    size_t allocated; // bytes allocated into the pool
-    size_t wasted;    // bytes at the end of a chunk that could not be used
-};
+/* Chunks are aligned to their size and start with a header naming the
+   worker that carves them and the node whose pool they came from, so any
+   block can be traced to its owner. */
+struct im_chunk_header {
+    worker_id owner;
+    unsigned int node;
+    unsigned int carved; // bytes carved once the owner moves on, else 0
+    unsigned int free;   // scratch space for trimming the node pool
+} __attribute__((aligned(CILK_CACHE_LINE)));
 
 struct im_bucket {
     void *free_list;          // beginning of free list
@@ -33,13 +37,59 @@ struct im_bucket {
     int allocated;     // Current allocations, in use or free
     int max_allocated; // high watermark of allocated
     long wasted;       // in bytes
+    // Blocks owned by this worker and freed by other workers.  Pushed
+    // lock-free by any worker, taken all at once by the owner.  Set to
+    // REMOTE_FREE_CLOSED when the owner terminates.
+    _Atomic(void *) remote_free;
 };
 
-/* One of these per worker, and one global */
+/* One of these per worker, and one per NUMA node */
 struct cilk_im_desc {
     struct im_bucket buckets[NUM_BUCKETS];
     long used; // local alloc - local free, may be negative
     long num_malloc[IM_NUM_TAGS];
+    // Bytes requested and bytes lost to size class rounding, per tag.
+    // Like used, these may be negative on a worker.
+    long requested[IM_NUM_TAGS];
+    long fragmentation[IM_NUM_TAGS];
+    // The remaining fields are only used by workers.
+    char *mem_begin;  // unused part of the chunk this worker is carving
+    char *mem_end;
+    long carved;      // bytes carved from chunks, not counted in global used
+    long num_remote_free; // blocks this worker returned to other workers
+    int node;         // NUMA node this worker allocates from, -1 if unknown
 };
 
+/* struct for managing the memory pool of one NUMA node; each memory region
+   in mem_list has size IM_REGION_SIZE and is placed on the node.  The
+   region is cut into chunks which are handed to workers on the node, and
+   workers allocate small pieces off their chunk into their im_descriptor
+   free lists.  Blocks that overflow a worker free list go to the free
+   lists of the node. */
+struct global_im_pool {
+    cilk_mutex lock;  // protects the pool and im_desc
+    unsigned int node;
+    char *mem_begin;  // unused part of the region that we are using
+    char *mem_end;
+    char **mem_list;  // list of memory regions obtained from system
+    unsigned mem_list_index; // index to the current region in use
+    unsigned mem_list_size;  // length of the mem_list
+    size_t num_chunks; // chunks handed out to workers
+    size_t allocated; // bytes allocated into the pool
+    size_t wasted;    // chunk headers and chunk tails that could not be used
+    // Chunks whose blocks were all free in the node pool.  They are reused
+    // before the region is cut any further.
+    char **free_chunks;
+    unsigned num_free_chunks;
+    unsigned free_chunks_size;
+    // Regions all of whose chunks were free, returned to the system whole
+    // so that their huge pages are not split.  They are reused before new
+    // regions are mapped.
+    char **free_regions;
+    unsigned num_free_regions;
+    unsigned free_regions_size;
+    size_t released_chunks; // chunks returned to the system, cumulative
+    struct cilk_im_desc im_desc;
+} __attribute__((aligned(CILK_CACHE_LINE)));
+
 #endif /* _INTERAL_MALLOC_IMPL_H */
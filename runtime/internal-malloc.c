@@ -1,33 +1,116 @@
+#include <assert.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h> /* ffs */
 #include <sys/mman.h>
 #include <unistd.h> /* sysconf */
+#ifdef __linux__
+#include <linux/mempolicy.h> /* MPOL_PREFERRED */
+#include <sys/syscall.h>
+#endif
 
 #include "cilk-internal.h"
+#include "cilk/cilk_api.h"
+#include "cilk/sentinel.h"
+#include "cilkred_map.h"
+#include "closure.h"
 #include "debug.h"
+#include "fiber.h"
 #include "global.h"
 #include "local.h"
+#include "scheduler.h"
+
+#if INLINE_ALL_TLS
+extern __thread __cilkrts_worker *tls_worker;
+#endif
 
 CHEETAH_INTERNAL int cheetah_page_shift = 0;
 
 #define MEM_LIST_SIZE 8U
 #define INTERNAL_MALLOC_CHUNK_SIZE (32 * 1024)
+/* Node pools get memory from the system in regions of one huge page. */
+#define IM_REGION_SIZE (2 * 1024 * 1024)
+#define MAX_NUMA_NODES 64
 #define SIZE_THRESH bucket_sizes[NUM_BUCKETS - 1]
 
-/* TODO: Use sizeof(fiber), sizeof(closure), etc. */
-static const unsigned int bucket_sizes[NUM_BUCKETS] = {32,  64,   128, 256,
-                                                       512, 1024, 2048};
-static const unsigned int bucket_capacity[NUM_BUCKETS] = {
-    256, /*   32 bytes a piece; 2 pages */
-    128, /*   64 bytes a piece; 2 pages */
-    64,  /*  128 bytes a piece; 2 pages */
-    64,  /*  256 bytes a piece; 4 pages */
-    32,  /*  512 bytes a piece; 4 pages */
-    16,  /* 1024 bytes a piece; 4 pages */
-    8    /* 2048 bytes a piece; 4 pages */
+/* Every size class is a whole number of cache lines.  Chunks are page
+   aligned, so every object carved out of a chunk is cache line aligned. */
+#define IM_LINE_SHIFT 6
+static_assert(CILK_CACHE_LINE == 1 << IM_LINE_SHIFT,
+              "IM_LINE_SHIFT does not match CILK_CACHE_LINE");
+#define ROUND_TO_LINE(size)                                                    \
+    (((size) + CILK_CACHE_LINE - 1) & ~(size_t)(CILK_CACHE_LINE - 1))
+
+/* Bytes of free objects a worker may cache in one bucket. */
+#define FREE_LIST_BYTES (16 * 1024)
+#define FREE_LIST_CAPACITY(size)                                               \
+    (FREE_LIST_BYTES / (size) > 256   ? 256                                    \
+     : FREE_LIST_BYTES / (size) < 8 ? 8                                        \
+                                      : FREE_LIST_BYTES / (size))
+
+/* The first NUM_TAG_BUCKETS buckets are slabs holding exactly one kind of
+   object; the rest are generic classes for views, hash buckets, and other
+   variable sized allocations. */
+enum {
+    CLOSURE_BUCKET,
+    FIBER_BUCKET,
+    REDUCER_MAP_BUCKET,
+    GENERIC_BUCKET
 };
+static_assert(GENERIC_BUCKET == NUM_TAG_BUCKETS, "wrong NUM_TAG_BUCKETS");
+
+#define CLOSURE_CLASS_SIZE ROUND_TO_LINE(sizeof(Closure))
+#define FIBER_CLASS_SIZE ROUND_TO_LINE(CILK_FIBER_SIZE)
+#define REDUCER_MAP_CLASS_SIZE ROUND_TO_LINE(sizeof(cilkred_map))
+
+static const unsigned int bucket_sizes[NUM_BUCKETS] = {
+    CLOSURE_CLASS_SIZE, FIBER_CLASS_SIZE, REDUCER_MAP_CLASS_SIZE,
+    64, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048};
+
+static const unsigned int bucket_capacity[NUM_BUCKETS] = {
+    FREE_LIST_CAPACITY(CLOSURE_CLASS_SIZE),
+    FREE_LIST_CAPACITY(FIBER_CLASS_SIZE),
+    FREE_LIST_CAPACITY(REDUCER_MAP_CLASS_SIZE),
+    FREE_LIST_CAPACITY(64),
+    FREE_LIST_CAPACITY(128),
+    FREE_LIST_CAPACITY(192),
+    FREE_LIST_CAPACITY(256),
+    FREE_LIST_CAPACITY(384),
+    FREE_LIST_CAPACITY(512),
+    FREE_LIST_CAPACITY(768),
+    FREE_LIST_CAPACITY(1024),
+    FREE_LIST_CAPACITY(1536),
+    FREE_LIST_CAPACITY(2048)};
+
+static_assert(CLOSURE_CLASS_SIZE <= 2048 && FIBER_CLASS_SIZE <= 2048 &&
+                  REDUCER_MAP_CLASS_SIZE <= 2048,
+              "fixed size objects must fit in the largest size class");
+
+/* Generic bucket indexed by object size in cache lines, rounded up. */
+#define G(n) (GENERIC_BUCKET + (n))
+static const unsigned char line_to_bucket[(2048 >> IM_LINE_SHIFT) + 1] = {
+    G(0), G(0), G(1),  G(2),  G(3),  G(4),  G(4),  G(5),  G(5),
+    G(6), G(6), G(6),  G(6),  G(7),  G(7),  G(7),  G(7),  G(8),
+    G(8), G(8), G(8),  G(8),  G(8),  G(8),  G(8),  G(9),  G(9),
+    G(9), G(9), G(9),  G(9),  G(9),  G(9)};
+#undef G
+
+/* Allocations of exactly this size with this tag use the tag's slab. */
+static const size_t tag_object_size[IM_NUM_TAGS] = {
+    [IM_UNCLASSIFIED] = 0,
+    [IM_CLOSURE] = sizeof(Closure),
+    [IM_FIBER] = CILK_FIBER_SIZE,
+    [IM_REDUCER_MAP] = sizeof(cilkred_map),
+    [IM_USER] = 0};
+
+static const unsigned char tag_bucket[IM_NUM_TAGS] = {
+    [IM_UNCLASSIFIED] = GENERIC_BUCKET,
+    [IM_CLOSURE] = CLOSURE_BUCKET,
+    [IM_FIBER] = FIBER_BUCKET,
+    [IM_REDUCER_MAP] = REDUCER_MAP_BUCKET,
+    [IM_USER] = GENERIC_BUCKET};
 
 struct free_block {
     void *next;
@@ -37,23 +120,15 @@ struct free_block {
 // Private helper functions
 //=========================================================
 
-static inline int is_page_aligned(size_t size) {
-    size_t mask = ((size_t)1 << cheetah_page_shift) - 1;
-    return ((size & mask) == 0);
-}
-
-static inline unsigned int size_to_bucket(size_t size) {
-    /* TODO: If sizes are powers of 2 use ffs() */
-    for (unsigned int i = 0; i < NUM_BUCKETS; i++) {
-        if (size <= bucket_sizes[i]) {
-            return i;
-        }
-    }
-    return -1; /* = infinity */
+static inline unsigned int size_to_bucket(size_t size, enum im_tag tag) {
+    if (size == tag_object_size[tag])
+        return tag_bucket[tag];
+    if (size > SIZE_THRESH)
+        return -1; /* = infinity */
+    return line_to_bucket[(size + CILK_CACHE_LINE - 1) >> IM_LINE_SHIFT];
 }
 
 static inline unsigned int bucket_to_size(int which_bucket) {
-    /* TODO: 1U << (which_bucket + 5) */
     return bucket_sizes[which_bucket];
 }
 
@@ -82,25 +157,126 @@ static void init_im_buckets(struct cilk_im_desc *im_desc) {
         bucket->allocated = 0;
         bucket->max_allocated = 0;
         bucket->wasted = 0;
+        atomic_init(&bucket->remote_free, NULL);
     }
     im_desc->used = 0;
-    for (int j = 0; j < IM_NUM_TAGS; ++j)
+    for (int j = 0; j < IM_NUM_TAGS; ++j) {
         im_desc->num_malloc[j] = 0;
+        im_desc->requested[j] = 0;
+        im_desc->fragmentation[j] = 0;
+    }
+    im_desc->mem_begin = im_desc->mem_end = NULL;
+    im_desc->carved = 0;
+    im_desc->num_remote_free = 0;
+    im_desc->node = -1;
+}
+
+static inline struct im_chunk_header *block_chunk(void *p) {
+    uintptr_t chunk =
+        (uintptr_t)p & ~(uintptr_t)(INTERNAL_MALLOC_CHUNK_SIZE - 1);
+    return (struct im_chunk_header *)chunk;
+}
+
+/* The worker that carved p out of its chunk. */
+static inline worker_id block_owner(void *p) { return block_chunk(p)->owner; }
+
+/* Number of NUMA nodes the system may have. */
+static unsigned int numa_node_count(void) {
+    unsigned int count = 1;
+#ifdef __linux__
+    FILE *f = fopen("/sys/devices/system/node/possible", "r");
+    if (f) {
+        unsigned int first, last;
+        if (fscanf(f, "%u-%u", &first, &last) == 2)
+            count = last + 1;
+        fclose(f);
+    }
+#endif
+    return count > MAX_NUMA_NODES ? MAX_NUMA_NODES : count;
+}
+
+/* The node pool worker w allocates from.  This is the node the worker
+   is running on the first time it asks, which is stable if workers are
+   pinned. */
+static struct global_im_pool *worker_pool(__cilkrts_worker *w) {
+    global_state *g = w->g;
+    struct cilk_im_desc *d = &w->l->im_desc;
+    if (d->node < 0) {
+        unsigned int cpu = 0, node = 0;
+#if defined(__linux__) && defined(SYS_getcpu)
+        if (g->im_num_nodes > 1)
+            syscall(SYS_getcpu, &cpu, &node, NULL);
+#endif
+        d->node = node % g->im_num_nodes;
+    }
+    return &g->im_pools[d->node];
+}
+
+/* Marks the remote free list of a worker that has terminated. */
+#define REMOTE_FREE_CLOSED ((void *)1)
+
+/* Return a block to the worker that owns it, unless the owner has closed
+   its list.  Any number of workers may push concurrently; the owner only
+   ever takes the whole list, so there is no ABA problem. */
+static bool push_remote_free(struct im_bucket *bucket, void *p) {
+    struct free_block *block = (struct free_block *)p;
+    void *head = atomic_load_explicit(&bucket->remote_free,
+                                      memory_order_relaxed);
+    do {
+        if (head == REMOTE_FREE_CLOSED)
+            return false;
+        block->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(
+        &bucket->remote_free, &head, p, memory_order_release,
+        memory_order_relaxed));
+    return true;
+}
+
+/* Move blocks other workers have returned onto the owner's free list.  If
+   close is set, no more blocks are accepted: the exchange that takes the
+   list also closes it, so no push can slip in after the last drain.  Only
+   the owner drains, so a closed list cannot be reopened by a race. */
+static void drain_remote_free(struct im_bucket *bucket, bool close) {
+    void *p = atomic_load_explicit(&bucket->remote_free, memory_order_relaxed);
+    if (p == REMOTE_FREE_CLOSED || (p == NULL && !close))
+        return;
+    p = atomic_exchange_explicit(&bucket->remote_free,
+                                 close ? REMOTE_FREE_CLOSED : NULL,
+                                 memory_order_acquire);
+    while (p) {
+        void *next = ((struct free_block *)p)->next;
+        add_to_free_list(bucket, p);
+        p = next;
+    }
 }
 
 //=========================================================
 // Private helper functions for debugging
 //=========================================================
 
+/* Bytes in remote free lists.  Only safe when workers are quiescent. */
+static size_t remote_free_bytes(struct cilk_im_desc *desc) {
+    size_t remote = 0;
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
+        void *p = atomic_load_explicit(&desc->buckets[i].remote_free,
+                                       memory_order_acquire);
+        for (; p && p != REMOTE_FREE_CLOSED;
+             p = ((struct free_block *)p)->next)
+            remote += bucket_sizes[i];
+    }
+    return remote;
+}
+
 static void dump_buckets(FILE *out, struct cilk_im_desc *d) {
-    fprintf(out, "  %zd bytes used\n", d->used);
+    fprintf(out, "  %zd bytes used, %ld remote frees\n", d->used,
+            d->num_remote_free);
     for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
         struct im_bucket *b = &d->buckets[i];
         if (!b->free_list && !b->free_list_size && !b->allocated)
             continue;
-        fprintf(out, "  [%u] %d allocated (%d max, %zd wasted), %u free\n",
-                bucket_to_size(i), b->allocated, b->max_allocated, b->wasted,
-                b->free_list_size);
+        fprintf(out, "  [%u%s] %d allocated (%d max, %zd wasted), %u free\n",
+                bucket_to_size(i), i < NUM_TAG_BUCKETS ? " slab" : "",
+                b->allocated, b->max_allocated, b->wasted, b->free_list_size);
     }
 }
 
@@ -127,6 +303,7 @@ static size_t workers_used_and_free(global_state *g) {
             continue; /* starting up or shutting down */
         local_state *l = w->l;
         worker_free += free_bytes(&l->im_desc);
+        worker_free += remote_free_bytes(&l->im_desc);
         worker_used += l->im_desc.used;
         worker_wasted += wasted_bytes(&l->im_desc);
     }
@@ -134,20 +311,98 @@ static size_t workers_used_and_free(global_state *g) {
     return worker_used + worker_free + worker_wasted;
 }
 
+/* Internal fragmentation of live objects, summed over node pools and
+   workers because objects may be freed by a worker other than the one
+   that allocated them. */
+static void dump_fragmentation(FILE *out, global_state *g) {
+    long num_malloc[IM_NUM_TAGS] = {0}, requested[IM_NUM_TAGS] = {0},
+         fragmentation[IM_NUM_TAGS] = {0};
+    for (unsigned int n = 0; n < g->im_num_nodes; n++) {
+        struct cilk_im_desc *d = &g->im_pools[n].im_desc;
+        for (int t = 0; t < IM_NUM_TAGS; ++t) {
+            num_malloc[t] += d->num_malloc[t];
+            requested[t] += d->requested[t];
+            fragmentation[t] += d->fragmentation[t];
+        }
+    }
+    for (unsigned int i = 0; i < g->nworkers; i++) {
+        __cilkrts_worker *w = g->workers[i];
+        if (!w)
+            continue;
+        for (int t = 0; t < IM_NUM_TAGS; ++t) {
+            num_malloc[t] += w->l->im_desc.num_malloc[t];
+            requested[t] += w->l->im_desc.requested[t];
+            fragmentation[t] += w->l->im_desc.fragmentation[t];
+        }
+    }
+    fprintf(out, "Internal fragmentation:\n");
+    for (int t = 0; t < IM_NUM_TAGS; ++t) {
+        long total = requested[t] + fragmentation[t];
+        fprintf(out, "  %-12s %ld live, %ld requested + %ld wasted (%.1f%%)\n",
+                name_for_im_tag((enum im_tag)t), num_malloc[t], requested[t],
+                fragmentation[t],
+                total > 0 ? 100.0 * fragmentation[t] / total : 0.0);
+    }
+}
+
+/* Bytes handed out to workers, either from the node free lists or
+   carved from their own chunks, and bytes not yet carved. */
+static void workers_carved_and_available(global_state *g, long *used,
+                                         size_t *available) {
+    *used = 0;
+    *available = 0;
+    for (unsigned int n = 0; n < g->im_num_nodes; n++) {
+        struct global_im_pool *pool = &g->im_pools[n];
+        *used += pool->im_desc.used;
+        *available += pool->mem_end - pool->mem_begin;
+    }
+    for (unsigned int i = 0; i < g->nworkers; i++) {
+        __cilkrts_worker *w = g->workers[i];
+        if (!w)
+            continue;
+        struct cilk_im_desc *d = &w->l->im_desc;
+        *used += d->carved;
+        *available += d->mem_end - d->mem_begin;
+    }
+}
+
+static void global_allocated_and_free(global_state *g, size_t *allocated,
+                                      size_t *wasted, size_t *free) {
+    *allocated = *wasted = *free = 0;
+    for (unsigned int n = 0; n < g->im_num_nodes; n++) {
+        struct global_im_pool *pool = &g->im_pools[n];
+        *allocated += pool->allocated;
+        *wasted += pool->wasted;
+        *free += free_bytes(&pool->im_desc);
+    }
+}
+
+static void dump_node_pool(FILE *out, struct global_im_pool *pool) {
+    fprintf(out,
+            "Node %u:\n  %zu allocated in %u regions, %zu chunks "
+            "(%zu wasted), %td available, %zu free\n",
+            pool->node, pool->allocated, pool->mem_list_index + 1,
+            pool->num_chunks, pool->wasted, pool->mem_end - pool->mem_begin,
+            free_bytes(&pool->im_desc));
+    dump_buckets(out, &pool->im_desc);
+}
+
 CHEETAH_INTERNAL
 void dump_memory_state(FILE *out, global_state *g) {
     if (out == NULL)
         out = stderr;
-    size_t global_free = free_bytes(&g->im_desc);
-    ptrdiff_t available =
-        (char *)g->im_pool.mem_end - (char *)g->im_pool.mem_begin;
+    size_t allocated, wasted, global_free;
+    global_allocated_and_free(g, &allocated, &wasted, &global_free);
+    long used;
+    size_t available;
+    workers_carved_and_available(g, &used, &available);
     fprintf(out,
-            "Global memory:\n  %zu allocated in %u blocks (%zu wasted)\n"
-            "  %zd used + %tu available + %zu free = %zu\n",
-            g->im_pool.allocated, g->im_pool.mem_list_index + 1,
-            g->im_pool.wasted, g->im_desc.used, available, global_free,
-            g->im_desc.used + available + global_free);
-    dump_buckets(out, &g->im_desc);
+            "Global memory:\n  %zu allocated in %u nodes (%zu wasted)\n"
+            "  %ld used + %zu available + %zu free = %zu\n",
+            allocated, g->im_num_nodes, wasted, used, available, global_free,
+            used + available + global_free);
+    for (unsigned int n = 0; n < g->im_num_nodes; n++)
+        dump_node_pool(out, &g->im_pools[n]);
     for (unsigned int i = 0; i < g->nworkers; i++) {
         __cilkrts_worker *w = g->workers[i];
         if (!w)
@@ -155,6 +410,7 @@ void dump_memory_state(FILE *out, global_state *g) {
         fprintf(out, "Worker %u:\n", i);
         dump_buckets(out, &w->l->im_desc);
     }
+    dump_fragmentation(out, g);
 }
 
 void dump_memory_state_stderr(global_state *g) { dump_memory_state(stderr, g); }
@@ -165,11 +421,12 @@ void internal_malloc_global_check(global_state *g) {
        global used = worker used + free
        global used + global free = allocated. */
 
-    struct cilk_im_desc *d = &(g->im_desc);
-
-    size_t total_malloc[IM_NUM_TAGS];
-    for (int i = 0; i < IM_NUM_TAGS; ++i)
-        total_malloc[i] = d->num_malloc[i];
+    size_t total_malloc[IM_NUM_TAGS] = {0};
+    for (unsigned int n = 0; n < g->im_num_nodes; n++) {
+        struct cilk_im_desc *d = &g->im_pools[n].im_desc;
+        for (int i = 0; i < IM_NUM_TAGS; ++i)
+            total_malloc[i] += d->num_malloc[i];
+    }
 
     for (unsigned int i = 0; i < g->nworkers; i++) {
         __cilkrts_worker *w = g->workers[i];
@@ -180,29 +437,32 @@ void internal_malloc_global_check(global_state *g) {
             total_malloc[i] += l->im_desc.num_malloc[i];
     }
 
-    size_t allocated = g->im_pool.allocated;
-    CILK_ASSERT_G(g->im_desc.used >= 0);
-    size_t global_used = g->im_desc.used;
-    size_t global_free = free_bytes(&g->im_desc);
+    size_t allocated, wasted, global_free;
+    global_allocated_and_free(g, &allocated, &wasted, &global_free);
+    long used;
+    size_t global_available;
+    workers_carved_and_available(g, &used, &global_available);
+    CILK_ASSERT_G(used >= 0);
+    size_t global_used = used;
     size_t worker_total = workers_used_and_free(g);
-    size_t global_available =
-        (char *)g->im_pool.mem_end - (char *)g->im_pool.mem_begin;
 
     if (global_used != worker_total ||
-        global_used + global_free + global_available != allocated)
+        global_used + global_free + global_available + wasted != allocated)
         dump_memory_state(stderr, g);
 
     CILK_CHECK(g,
-               global_used + global_free + global_available == allocated &&
+               global_used + global_free + global_available + wasted ==
+                       allocated &&
                    global_used == worker_total,
-               "Possible memory leak: %zu+%zu+%zu global used+free+available, "
-               "%zu allocated, %zu in workers",
-               global_used, global_free, global_available, allocated,
+               "Possible memory leak: %zu+%zu+%zu+%zu global "
+               "used+free+available+wasted, %zu allocated, %zu in workers",
+               global_used, global_free, global_available, wasted, allocated,
                worker_total);
 }
 
 static void assert_global_pool(struct global_im_pool *pool) {
-    CILK_ASSERT_G(pool->mem_list_index < pool->mem_list_size);
+    CILK_ASSERT_G(pool->mem_list_index < pool->mem_list_size ||
+                  pool->mem_list_index == (unsigned)-1);
     if (pool->wasted > 0)
         CILK_ASSERT_G(pool->wasted < pool->allocated);
 }
@@ -252,12 +512,15 @@ static void print_im_buckets_stats(struct global_state *g) {
     fprintf(stderr, "\n-------------------------------------------"
                     "---------------------------------------------\n");
 
-    fprintf(stderr, HDR_DESC, "Global:");
-    for (unsigned int j = 0; j < NUM_BUCKETS; j++) {
-        fprintf(stderr, FIELD_DESC,
-                (size_t)g->im_desc.buckets[j].free_list_size * bucket_sizes[j]);
+    for (unsigned int n = 0; n < g->im_num_nodes; n++) {
+        struct cilk_im_desc *d = &g->im_pools[n].im_desc;
+        fprintf(stderr, WORKER_HDR_DESC, "Node", n);
+        for (unsigned int j = 0; j < NUM_BUCKETS; j++) {
+            fprintf(stderr, FIELD_DESC,
+                    (size_t)d->buckets[j].free_list_size * bucket_sizes[j]);
+        }
+        fprintf(stderr, "\n");
     }
-    fprintf(stderr, "\n");
     for_each_worker(g, &print_worker_buckets_free, stderr);
 
     fprintf(stderr, "\nHIGH WATERMARK FOR BYTES ALLOCATED:\n");
@@ -274,14 +537,34 @@ static void print_im_buckets_stats(struct global_state *g) {
 
 static void print_internal_malloc_stats(struct global_state *g) {
     unsigned page_size = 1U << cheetah_page_shift;
+    size_t allocated, wasted, global_free;
+    global_allocated_and_free(g, &allocated, &wasted, &global_free);
     fprintf(stderr, "\nINTERNAL MALLOC STATS\n");
     fprintf(stderr,
             "Total bytes allocated from system: %7zu KBytes (%zu pages)\n",
-            g->im_pool.allocated / 1024,
-            (g->im_pool.allocated + page_size - 1) / page_size);
+            allocated / 1024, (allocated + page_size - 1) / page_size);
     fprintf(stderr, "Total bytes allocated but wasted:  %7zu KBytes\n",
-            g->im_pool.wasted / 1024);
+            wasted / 1024);
+    for (unsigned int n = 0; n < g->im_num_nodes; n++) {
+        struct global_im_pool *pool = &g->im_pools[n];
+        fprintf(stderr,
+                "  Node %2u: %7zu KBytes in %u regions, %zu chunks to "
+                "workers\n",
+                n, pool->allocated / 1024, pool->mem_list_index + 1,
+                pool->num_chunks);
+    }
+    long remote = 0;
+    for (unsigned int i = 0; i < g->nworkers; i++)
+        if (g->workers[i])
+            remote += g->workers[i]->l->im_desc.num_remote_free;
+    fprintf(stderr, "Blocks returned to owning worker:  %7ld\n", remote);
+    size_t released = 0;
+    for (unsigned int n = 0; n < g->im_num_nodes; n++)
+        released += g->im_pools[n].released_chunks;
+    fprintf(stderr, "Chunks returned to system:         %7zu (%zu KBytes)\n",
+            released, released * INTERNAL_MALLOC_CHUNK_SIZE / 1024);
     print_im_buckets_stats(g);
+    dump_fragmentation(stderr, g);
     fprintf(stderr, "\n");
 }
 
@@ -289,97 +572,186 @@ static void print_internal_malloc_stats(struct global_state *g) {
 // Global memory allocator
 //=========================================================
 
+/* Objects larger than any bucket come from the system malloc, which keeps
+   freed memory for reuse.  Mapping page-multiple sizes directly would cost
+   a system call for every allocation and free. */
 static char *malloc_from_system(__cilkrts_worker *w, size_t size) {
-    void *mem;
-    if (is_page_aligned(size)) {
-        mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
-                   -1, 0);
-    } else {
-        mem = malloc(size);
-    }
+    void *mem = cilk_aligned_alloc(CILK_CACHE_LINE, ROUND_TO_LINE(size));
     CILK_CHECK(w->g, mem, "Internal malloc failed to allocate %zu bytes", size);
     return mem;
 }
 
-static void free_to_system(void *p, size_t size) {
-    if (is_page_aligned(size)) {
-        munmap(p, size);
-    } else {
-        free(p);
+static void free_to_system(void *p, size_t size) { free(p); }
+
+/* Get a region aligned to its own size, so the chunks cut from it are
+   aligned to theirs and the chunk header can be found from any block.
+   The region is backed by a huge page if the system allows it and is
+   placed on the pool's node. */
+static char *region_from_system(global_state *g, struct global_im_pool *pool) {
+    const size_t size = IM_REGION_SIZE;
+    char *mem = mmap(0, 2 * size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CILK_CHECK(g, mem != MAP_FAILED,
+               "Internal malloc failed to allocate %zu bytes", 2 * size);
+    char *region =
+        (char *)(((uintptr_t)mem + size - 1) & ~(uintptr_t)(size - 1));
+    if (region > mem)
+        munmap(mem, region - mem);
+    if (region < mem + size)
+        munmap(region + size, mem + size - region);
+#ifdef MADV_HUGEPAGE
+    madvise(region, size, MADV_HUGEPAGE);
+#endif
+#if defined(__linux__) && defined(SYS_mbind)
+    // Without a policy the pages go wherever the owning worker of each
+    // chunk first touches them, which is usually the same node.
+    if (g->im_num_nodes > 1) {
+        unsigned long nodemask = 1UL << pool->node;
+        // The kernel reads maxnode - 1 bits of the mask.
+        syscall(SYS_mbind, region, size, MPOL_PREFERRED, &nodemask,
+                8 * sizeof(nodemask) + 1, 0);
     }
+#endif
+    return region;
 }
 
 /**
- * Extend the global im pool.  This function is only called when the
- * current chunk in use is not big enough to satisfy an allocation.
- * The size is already canonicalized at this point.
+ * Extend a node pool by one region.  This function is only called when
+ * the current region is used up.  The caller holds the pool lock.
  */
-static void extend_global_pool(__cilkrts_worker *w) {
-
-    struct global_im_pool *im_pool = &(w->g->im_pool);
-    im_pool->mem_begin = malloc_from_system(w, INTERNAL_MALLOC_CHUNK_SIZE);
-    im_pool->mem_end = im_pool->mem_begin + INTERNAL_MALLOC_CHUNK_SIZE;
-    im_pool->allocated += INTERNAL_MALLOC_CHUNK_SIZE;
-    im_pool->mem_list_index++;
-
-    if (im_pool->mem_list_index >= im_pool->mem_list_size) {
-        size_t new_list_size = im_pool->mem_list_size + MEM_LIST_SIZE;
-        im_pool->mem_list = realloc(im_pool->mem_list,
-                                    new_list_size * sizeof(*im_pool->mem_list));
-        im_pool->mem_list_size = new_list_size;
-        CILK_CHECK(w->g, im_pool->mem_list,
+static void extend_global_pool(global_state *g, struct global_im_pool *pool) {
+    if (pool->num_free_regions > 0) {
+        // A region that was trimmed is already in mem_list.
+        pool->mem_begin = pool->free_regions[--pool->num_free_regions];
+        pool->mem_end = pool->mem_begin + IM_REGION_SIZE;
+        pool->allocated += IM_REGION_SIZE;
+        return;
+    }
+    pool->mem_begin = region_from_system(g, pool);
+    pool->mem_end = pool->mem_begin + IM_REGION_SIZE;
+    pool->allocated += IM_REGION_SIZE;
+    pool->mem_list_index++;
+
+    if (pool->mem_list_index >= pool->mem_list_size) {
+        size_t new_list_size = pool->mem_list_size + MEM_LIST_SIZE;
+        pool->mem_list =
+            realloc(pool->mem_list, new_list_size * sizeof(*pool->mem_list));
+        pool->mem_list_size = new_list_size;
+        CILK_CHECK(g, pool->mem_list,
                    "Failed to extend global memory list by %zu bytes",
-                   MEM_LIST_SIZE * sizeof(*im_pool->mem_list));
+                   MEM_LIST_SIZE * sizeof(*pool->mem_list));
     }
-    im_pool->mem_list[im_pool->mem_list_index] = im_pool->mem_begin;
+    pool->mem_list[pool->mem_list_index] = pool->mem_begin;
 }
 
 /**
- * Allocate a piece of memory of 'size' from global im bucket 'bucket'.
- * The free_list is last-in-first-out.
- * The size is already canonicalized at this point.
+ * Cut a chunk for worker w from the region of its node pool.  The caller
+ * holds the pool lock.
  */
-static void *global_im_alloc(__cilkrts_worker *w, size_t size,
-                             unsigned int which_bucket) {
-    global_state *g = w->g;
-    CILK_ASSERT(w, g);
-    CILK_ASSERT(w, size <= SIZE_THRESH);
-    CILK_ASSERT(w, which_bucket < NUM_BUCKETS);
-
-    struct im_bucket *bucket = &(g->im_desc.buckets[which_bucket]);
-    struct cilk_im_desc *im_desc = &(g->im_desc);
-    im_desc->used += size;
-    /* ??? count calls to this function? */
+static char *global_im_alloc_chunk(__cilkrts_worker *w,
+                                   struct global_im_pool *pool) {
+    char *chunk;
+    if (pool->num_free_chunks > 0) {
+        chunk = pool->free_chunks[--pool->num_free_chunks];
+        pool->allocated += INTERNAL_MALLOC_CHUNK_SIZE;
+    } else {
+        if (pool->mem_begin == pool->mem_end)
+            extend_global_pool(w->g, pool);
+        chunk = pool->mem_begin;
+        pool->mem_begin += INTERNAL_MALLOC_CHUNK_SIZE;
+    }
+    pool->wasted += sizeof(struct im_chunk_header);
+    pool->num_chunks++;
+    struct im_chunk_header *header = (struct im_chunk_header *)chunk;
+    header->owner = w->self;
+    header->node = pool->node;
+    header->carved = 0;
+    return chunk;
+}
 
-    void *mem = remove_from_free_list(bucket);
-    if (!mem) {
-        struct global_im_pool *im_pool = &(g->im_pool);
-        // allocate from the global pool
-        if ((im_pool->mem_begin + size) > im_pool->mem_end) {
-            // consider the left over as waste for now
-            // TODO: Adding it to a random free list would be better.
-            im_pool->wasted += im_pool->mem_end - im_pool->mem_begin;
-            extend_global_pool(w);
-        }
-        mem = im_pool->mem_begin;
-        im_pool->mem_begin += size;
+/* Record how much of the chunk the worker is carving was handed out, so
+   trimming can tell when all of its blocks are free again. */
+static void retire_chunk(struct cilk_im_desc *im_desc) {
+    if (im_desc->mem_end) {
+        struct im_chunk_header *header = block_chunk(im_desc->mem_end - 1);
+        header->carved = im_desc->mem_begin - (char *)(header + 1);
     }
+}
 
+/**
+ * Carve a piece of memory of 'size' from the chunk owned by worker w,
+ * taking a new chunk from its node pool if the current one is used up.
+ * The size is already canonicalized at this point.
+ */
+static void *worker_im_carve(__cilkrts_worker *w, size_t size) {
+    CILK_ASSERT(w, size <= SIZE_THRESH);
+    struct cilk_im_desc *im_desc = &(w->l->im_desc);
+    if ((im_desc->mem_begin + size) > im_desc->mem_end) {
+        struct global_im_pool *pool = worker_pool(w);
+        cilk_mutex_lock(&(pool->lock));
+        // consider the left over as waste for now
+        pool->wasted += im_desc->mem_end - im_desc->mem_begin;
+        retire_chunk(im_desc);
+        char *chunk = global_im_alloc_chunk(w, pool);
+        cilk_mutex_unlock(&(pool->lock));
+        im_desc->mem_begin = chunk + sizeof(struct im_chunk_header);
+        im_desc->mem_end = chunk + INTERNAL_MALLOC_CHUNK_SIZE;
+    }
+    void *mem = im_desc->mem_begin;
+    im_desc->mem_begin += size;
+    im_desc->carved += size;
     return mem;
 }
 
+static void global_im_pool_init(global_state *g, struct global_im_pool *pool,
+                                unsigned int node) {
+    cilk_mutex_init(&(pool->lock));
+    pool->node = node;
+    pool->mem_begin = pool->mem_end = NULL;
+    pool->mem_list_index = -1;
+    pool->mem_list_size = MEM_LIST_SIZE;
+    pool->mem_list = calloc(MEM_LIST_SIZE, sizeof(*pool->mem_list));
+    CILK_CHECK(g, pool->mem_list,
+               "Cannot allocate %u * %zu bytes for mem_list", MEM_LIST_SIZE,
+               sizeof(*pool->mem_list));
+    pool->num_chunks = 0;
+    pool->allocated = 0;
+    pool->wasted = 0;
+    pool->free_chunks = NULL;
+    pool->num_free_chunks = 0;
+    pool->free_chunks_size = 0;
+    pool->free_regions = NULL;
+    pool->num_free_regions = 0;
+    pool->free_regions_size = 0;
+    pool->released_chunks = 0;
+    init_im_buckets(&pool->im_desc);
+}
+
 static void global_im_pool_destroy(struct global_im_pool *im_pool) {
 
     for (unsigned i = 0; i < im_pool->mem_list_size; i++) {
         void *mem = im_pool->mem_list[i];
-        free_to_system(mem, INTERNAL_MALLOC_CHUNK_SIZE);
+        if (mem)
+            munmap(mem, IM_REGION_SIZE);
         im_pool->mem_list[i] = NULL;
     }
     free(im_pool->mem_list);
     im_pool->mem_list = NULL;
+    free(im_pool->free_chunks);
+    im_pool->free_chunks = NULL;
+    im_pool->num_free_chunks = im_pool->free_chunks_size = 0;
+    free(im_pool->free_regions);
+    im_pool->free_regions = NULL;
+    im_pool->num_free_regions = im_pool->free_regions_size = 0;
     im_pool->mem_begin = im_pool->mem_end = NULL;
     im_pool->mem_list_index = -1;
     im_pool->mem_list_size = 0;
+    cilk_mutex_destroy(&(im_pool->lock));
+    /* User code need not free its blocks before the program exits. */
+    for (int i = 0; i < IM_NUM_TAGS; ++i) {
+        if (i != IM_USER)
+            CILK_ASSERT_G(im_pool->im_desc.num_malloc[i] == 0);
+    }
 }
 
 void cilk_internal_malloc_global_init(global_state *g) {
@@ -389,21 +761,14 @@ void cilk_internal_malloc_global_init(global_state *g) {
         cheetah_page_shift = ffs(cheetah_page_size) - 1;
         CILK_ASSERT_G((1 << cheetah_page_shift) == cheetah_page_size);
     }
-    cilk_mutex_init(&(g->im_lock));
-    g->im_pool.mem_begin = g->im_pool.mem_end = NULL;
-    g->im_pool.mem_list_index = -1;
-    g->im_pool.mem_list_size = MEM_LIST_SIZE;
-    g->im_pool.mem_list = calloc(MEM_LIST_SIZE, sizeof(*g->im_pool.mem_list));
-    CILK_CHECK(g, g->im_pool.mem_list,
-               "Cannot allocate %u * %zu bytes for mem_list", MEM_LIST_SIZE,
-               sizeof(*g->im_pool.mem_list));
-    g->im_pool.allocated = 0;
-    g->im_pool.wasted = 0;
-    init_im_buckets(&g->im_desc);
-
-    g->im_desc.used = 0;
-    for (int i = 0; i < IM_NUM_TAGS; ++i)
-        g->im_desc.num_malloc[i] = 0;
+    g->im_num_nodes = numa_node_count();
+    g->im_pools = (struct global_im_pool *)cilk_aligned_alloc(
+        __alignof(struct global_im_pool),
+        g->im_num_nodes * sizeof(struct global_im_pool));
+    CILK_CHECK(g, g->im_pools, "Cannot allocate %u internal malloc pools",
+               g->im_num_nodes);
+    for (unsigned int n = 0; n < g->im_num_nodes; n++)
+        global_im_pool_init(g, &g->im_pools[n], n);
 }
 
 void cilk_internal_malloc_global_terminate(global_state *g) {
@@ -414,11 +779,11 @@ void cilk_internal_malloc_global_terminate(global_state *g) {
 }
 
 void cilk_internal_malloc_global_destroy(global_state *g) {
-    global_im_pool_destroy(&(g->im_pool)); // free global mem blocks
-    cilk_mutex_destroy(&(g->im_lock));
-    for (int i = 0; i < IM_NUM_TAGS; ++i) {
-        CILK_ASSERT_G(g->im_desc.num_malloc[i] == 0);
-    }
+    for (unsigned int n = 0; n < g->im_num_nodes; n++)
+        global_im_pool_destroy(&g->im_pools[n]); // free global mem blocks
+    free(g->im_pools);
+    g->im_pools = NULL;
+    g->im_num_nodes = 0;
 }
 
 //=========================================================
@@ -426,21 +791,29 @@ void cilk_internal_malloc_global_destroy(global_state *g) {
 //=========================================================
 
 /**
- * Allocate a batch of memory of size 'size' from global im bucket 'bucket'
- * into per-worker im bucket 'bucket'.
+ * Allocate a batch of memory of size 'size' into per-worker im bucket
+ * 'bucket', preferring blocks in the node im bucket 'bucket' and carving
+ * the rest from the worker's own chunk.
  */
 static void im_allocate_batch(__cilkrts_worker *w, size_t size,
                               unsigned int bucket_index) {
-    global_state *g = w->g;
     local_state *l = w->l;
+    struct global_im_pool *pool = worker_pool(w);
     struct im_bucket *bucket = &l->im_desc.buckets[bucket_index];
+    struct im_bucket *node_bucket = &pool->im_desc.buckets[bucket_index];
     unsigned int batch_size = bucket_capacity[bucket_index] / 2;
-    cilk_mutex_lock(&(g->im_lock));
-    for (unsigned int i = 0; i < batch_size; i++) {
-        void *p = global_im_alloc(w, size, bucket_index);
+    unsigned int i = 0;
+    cilk_mutex_lock(&(pool->lock));
+    for (; i < batch_size; i++) {
+        void *p = remove_from_free_list(node_bucket);
+        if (!p)
+            break;
         add_to_free_list(bucket, p);
     }
-    cilk_mutex_unlock(&(g->im_lock));
+    pool->im_desc.used += (long)i * size;
+    cilk_mutex_unlock(&(pool->lock));
+    for (; i < batch_size; i++)
+        add_to_free_list(bucket, worker_im_carve(w, size));
     bucket->allocated += batch_size;
     if (bucket->allocated > bucket->max_allocated) {
         bucket->max_allocated = bucket->allocated;
@@ -449,24 +822,24 @@ static void im_allocate_batch(__cilkrts_worker *w, size_t size,
 
 /**
  * Free a batch of memory of size 'size' from per-worker im bucket 'bucket'
- * back to global im bucket 'bucket'.
+ * back to the node im bucket 'bucket'.
  */
 static void im_free_batch(__cilkrts_worker *w, size_t size,
                           unsigned int which_bucket) {
-    global_state *g = w->g;
     local_state *l = w->l;
+    struct global_im_pool *pool = worker_pool(w);
     unsigned int batch_size = bucket_capacity[which_bucket] / 2;
     struct im_bucket *bucket = &(l->im_desc.buckets[which_bucket]);
-    cilk_mutex_lock(&(g->im_lock));
+    cilk_mutex_lock(&(pool->lock));
     for (unsigned int i = 0; i < batch_size; ++i) {
         void *mem = remove_from_free_list(bucket);
         if (!mem)
             break;
-        add_to_free_list(&g->im_desc.buckets[which_bucket], mem);
-        g->im_desc.used -= size;
+        add_to_free_list(&pool->im_desc.buckets[which_bucket], mem);
+        pool->im_desc.used -= size;
         --bucket->allocated;
     }
-    cilk_mutex_unlock(&(w->g->im_lock));
+    cilk_mutex_unlock(&(pool->lock));
     /* Account for bytes allocated change? */
 }
 
@@ -477,7 +850,7 @@ static void im_free_batch(__cilkrts_worker *w, size_t size,
 CHEETAH_INTERNAL
 void *cilk_internal_malloc(__cilkrts_worker *w, size_t size, enum im_tag tag) {
     local_state *l = w->l;
-    unsigned int which_bucket = size_to_bucket(size);
+    unsigned int which_bucket = size_to_bucket(size, tag);
     if (which_bucket >= NUM_BUCKETS) {
         return malloc_from_system(w, size);
     }
@@ -490,10 +863,18 @@ void *cilk_internal_malloc(__cilkrts_worker *w, size_t size, enum im_tag tag) {
     unsigned int csize = bucket_to_size(which_bucket); // canonicalize the size
     struct im_bucket *bucket = &(l->im_desc.buckets[which_bucket]);
     bucket->wasted += csize - size;
+    l->im_desc.requested[tag] += size;
+    l->im_desc.fragmentation[tag] += csize - size;
     void *mem = remove_from_free_list(bucket);
 
-    if (!mem) { // when out of memory, allocate a batch from global pool
-        im_allocate_batch(w, csize, which_bucket);
+    if (!mem) {
+        // Take back blocks other workers have freed before asking the
+        // global pool for more.
+        drain_remote_free(bucket, false);
+        while (bucket->free_list_size > bucket->free_list_limit)
+            im_free_batch(w, csize, which_bucket);
+        if (!bucket->free_list)
+            im_allocate_batch(w, csize, which_bucket);
         mem = remove_from_free_list(bucket);
         CILK_ASSERT(w, mem);
     }
@@ -507,11 +888,13 @@ void *cilk_internal_malloc(__cilkrts_worker *w, size_t size, enum im_tag tag) {
 }
 
 /*
- * Free simply returns to the free list; last-in-first-out
+ * Free returns to the free list of the worker that carved the block;
+ * last-in-first-out
  */
 void cilk_internal_free(__cilkrts_worker *w, void *p, size_t size,
                         enum im_tag tag) {
-    if (size > SIZE_THRESH) {
+    unsigned int which_bucket = size_to_bucket(size, tag);
+    if (which_bucket >= NUM_BUCKETS) {
         free_to_system(p, size);
         return;
     }
@@ -522,11 +905,21 @@ void cilk_internal_free(__cilkrts_worker *w, void *p, size_t size,
     l->im_desc.used -= size;
     l->im_desc.num_malloc[tag] -= 1;
 
-    unsigned int which_bucket = size_to_bucket(size);
-    CILK_ASSERT(w, which_bucket >= 0 && which_bucket < NUM_BUCKETS);
     unsigned int csize = bucket_to_size(which_bucket); // canonicalize the size
     struct im_bucket *bucket = &(l->im_desc.buckets[which_bucket]);
     bucket->wasted -= csize - size;
+    l->im_desc.requested[tag] -= size;
+    l->im_desc.fragmentation[tag] -= csize - size;
+
+    worker_id owner = block_owner(p);
+    if (owner != w->self) {
+        __cilkrts_worker *ow = w->g->workers[owner];
+        if (ow && push_remote_free(&ow->l->im_desc.buckets[which_bucket],
+                                   p)) {
+            l->im_desc.num_remote_free += 1;
+            return;
+        }
+    }
 
     add_to_free_list(bucket, p);
 
@@ -545,10 +938,14 @@ void cilk_internal_free(__cilkrts_worker *w, void *p, size_t size,
    It has no locking. */
 void cilk_internal_free_global(global_state *g, void *p, size_t size,
                                enum im_tag tag) {
-    unsigned int which_bucket = size_to_bucket(size);
-    add_to_free_list(&g->im_desc.buckets[which_bucket], p);
-    g->im_desc.num_malloc[tag]--;
-    g->im_desc.used -= bucket_to_size(which_bucket);
+    unsigned int which_bucket = size_to_bucket(size, tag);
+    unsigned int csize = bucket_to_size(which_bucket);
+    struct cilk_im_desc *d = &g->im_pools[block_chunk(p)->node].im_desc;
+    add_to_free_list(&d->buckets[which_bucket], p);
+    d->num_malloc[tag]--;
+    d->requested[tag] -= size;
+    d->fragmentation[tag] -= csize - size;
+    d->used -= csize;
 }
 
 void cilk_internal_malloc_per_worker_init(__cilkrts_worker *w) {
@@ -558,17 +955,30 @@ void cilk_internal_malloc_per_worker_init(__cilkrts_worker *w) {
 void cilk_internal_malloc_per_worker_terminate(__cilkrts_worker *w) {
     global_state *g = w->g; /* Global state is locked by caller. */
     local_state *l = w->l;
-    assert_global_pool(&g->im_pool);
+    struct global_im_pool *pool = worker_pool(w);
+    assert_global_pool(pool);
     if (DEBUG_ENABLED(MEMORY_SLOW))
         internal_malloc_global_check(g);
     for (unsigned int i = 0; i < NUM_BUCKETS; i++) {
         assert_bucket(&l->im_desc.buckets[i]);
+        // Blocks freed after this point by workers that have not yet
+        // terminated stay with those workers.
+        drain_remote_free(&l->im_desc.buckets[i], true);
         while (l->im_desc.buckets[i].free_list)
             im_free_batch(w, bucket_to_size(i), i);
     }
+    pool->im_desc.used += l->im_desc.carved;
+    pool->wasted += l->im_desc.mem_end - l->im_desc.mem_begin;
+    retire_chunk(&l->im_desc);
+    l->im_desc.carved = 0;
+    l->im_desc.mem_begin = l->im_desc.mem_end = NULL;
     for (int i = 0; i < IM_NUM_TAGS; ++i) {
-        g->im_desc.num_malloc[i] += l->im_desc.num_malloc[i];
+        pool->im_desc.num_malloc[i] += l->im_desc.num_malloc[i];
+        pool->im_desc.requested[i] += l->im_desc.requested[i];
+        pool->im_desc.fragmentation[i] += l->im_desc.fragmentation[i];
         l->im_desc.num_malloc[i] = 0;
+        l->im_desc.requested[i] = 0;
+        l->im_desc.fragmentation[i] = 0;
     }
     if (ALERT_ENABLED(MEMORY))
         dump_memory_state(NULL, w->g);
@@ -588,6 +998,170 @@ void cilk_internal_malloc_per_worker_destroy(__cilkrts_worker *w) {
     }
 }
 
+//=========================================================
+// Returning memory to the system
+//=========================================================
+
+#define CHUNK_KEEP ((unsigned int)-1)
+#define CHUNK_RELEASE ((unsigned int)-2)
+
+#define CHUNKS_PER_REGION (IM_REGION_SIZE / INTERNAL_MALLOC_CHUNK_SIZE)
+
+/* Append mem to a list of free chunks or regions.  The caller holds the
+   pool lock. */
+static void push_free_mem(global_state *g, char ***list, unsigned *num,
+                          unsigned *size, char *mem) {
+    if (*num == *size) {
+        unsigned new_size = *size + MEM_LIST_SIZE;
+        char **larger = realloc(*list, new_size * sizeof(**list));
+        CILK_CHECK(g, larger, "Failed to extend free memory list to %u",
+                   new_size);
+        *list = larger;
+        *size = new_size;
+    }
+    (*list)[(*num)++] = mem;
+}
+
+/* Save a released chunk for reuse.  The caller holds the pool lock. */
+static void push_free_chunk(global_state *g, struct global_im_pool *pool,
+                            char *chunk) {
+    push_free_mem(g, &pool->free_chunks, &pool->num_free_chunks,
+                  &pool->free_chunks_size, chunk);
+}
+
+static inline char *chunk_region(const char *chunk) {
+    return (char *)((uintptr_t)chunk & ~(uintptr_t)(IM_REGION_SIZE - 1));
+}
+
+static int compare_chunks(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t)*(char *const *)a;
+    uintptr_t y = (uintptr_t)*(char *const *)b;
+    return (x > y) - (x < y);
+}
+
+/* Return to the system the regions all of whose chunks are free, and move
+   them from the free chunks to the free regions.  Regions are returned
+   whole, since returning single chunks would split the huge pages that
+   back them.  The caller holds the pool lock.  Returns the number of
+   regions returned. */
+static unsigned release_free_regions(global_state *g,
+                                     struct global_im_pool *pool) {
+    char **chunks = pool->free_chunks;
+    unsigned n = pool->num_free_chunks, kept = 0, count = 0;
+    qsort(chunks, n, sizeof(*chunks), compare_chunks);
+    for (unsigned i = 0, j; i < n; i = j) {
+        char *region = chunk_region(chunks[i]);
+        for (j = i + 1; j < n && chunk_region(chunks[j]) == region; ++j)
+            ;
+        if (j - i == CHUNKS_PER_REGION) {
+            madvise(region, IM_REGION_SIZE, MADV_DONTNEED);
+            push_free_mem(g, &pool->free_regions, &pool->num_free_regions,
+                          &pool->free_regions_size, region);
+            ++count;
+        } else {
+            memmove(&chunks[kept], &chunks[i], (j - i) * sizeof(*chunks));
+            kept += j - i;
+        }
+    }
+    pool->num_free_chunks = kept;
+    return count;
+}
+
+/**
+ * Take the chunks whose blocks are all on the free lists of the node off
+ * those lists until at most keep bytes are free, and return the pages of
+ * the regions that are then wholly free.  Chunks a worker is still carving
+ * are never released.  Returns the number of bytes returned.
+ */
+static size_t im_pool_trim(global_state *g, struct global_im_pool *pool,
+                           size_t keep) {
+    struct cilk_im_desc *d = &pool->im_desc;
+    cilk_mutex_lock(&pool->lock);
+    size_t free_total = free_bytes(d);
+    if (free_total <= keep) {
+        cilk_mutex_unlock(&pool->lock);
+        return 0;
+    }
+    // Count the free bytes of each chunk with a block on a free list.
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i)
+        for (void *p = d->buckets[i].free_list; p;
+             p = ((struct free_block *)p)->next)
+            block_chunk(p)->free = 0;
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i)
+        for (void *p = d->buckets[i].free_list; p;
+             p = ((struct free_block *)p)->next)
+            block_chunk(p)->free += bucket_sizes[i];
+    // Decide which chunks to release, the first time each is seen.
+    unsigned first = pool->num_free_chunks;
+    size_t released = 0;
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i)
+        for (void *p = d->buckets[i].free_list; p;
+             p = ((struct free_block *)p)->next) {
+            struct im_chunk_header *c = block_chunk(p);
+            if (c->free == CHUNK_KEEP || c->free == CHUNK_RELEASE)
+                continue;
+            if (c->carved && c->free == c->carved &&
+                free_total - released > keep) {
+                released += c->carved;
+                c->free = CHUNK_RELEASE;
+                push_free_chunk(g, pool, (char *)c);
+            } else {
+                c->free = CHUNK_KEEP;
+            }
+        }
+    if (!released) {
+        cilk_mutex_unlock(&pool->lock);
+        return 0;
+    }
+    // Drop the blocks of released chunks from the free lists.
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
+        struct im_bucket *bucket = &d->buckets[i];
+        void **link = &bucket->free_list;
+        while (*link) {
+            struct free_block *block = (struct free_block *)*link;
+            if (block_chunk(block)->free == CHUNK_RELEASE) {
+                *link = block->next;
+                --bucket->free_list_size;
+            } else {
+                link = &block->next;
+            }
+        }
+    }
+    for (unsigned i = first; i < pool->num_free_chunks; ++i) {
+        struct im_chunk_header *c =
+            (struct im_chunk_header *)pool->free_chunks[i];
+        pool->wasted -= INTERNAL_MALLOC_CHUNK_SIZE - c->carved;
+        pool->allocated -= INTERNAL_MALLOC_CHUNK_SIZE;
+        pool->num_chunks--;
+    }
+    unsigned count = release_free_regions(g, pool);
+    pool->released_chunks += (size_t)count * CHUNKS_PER_REGION;
+    cilk_mutex_unlock(&pool->lock);
+    cilkrts_alert(MEMORY, NULL, "Node %u returned %u regions to the system",
+                  pool->node, count);
+    return (size_t)count * IM_REGION_SIZE;
+}
+
+/* Move every free block cached by worker w to its node pool so that
+   chunks it has finished with can be trimmed.  Called by w. */
+void cilk_internal_malloc_per_worker_trim(__cilkrts_worker *w) {
+    local_state *l = w->l;
+    for (unsigned int i = 0; i < NUM_BUCKETS; i++) {
+        drain_remote_free(&l->im_desc.buckets[i], false);
+        while (l->im_desc.buckets[i].free_list)
+            im_free_batch(w, bucket_to_size(i), i);
+    }
+}
+
+/* Release free chunks of each node pool beyond the trim_memory high-water
+   mark.  Safe to call while workers run. */
+size_t cilk_internal_malloc_global_trim(global_state *g) {
+    size_t released = 0;
+    for (unsigned int n = 0; n < g->im_num_nodes; n++)
+        released += im_pool_trim(g, &g->im_pools[n], g->options.trim_memory);
+    return released;
+}
+
 const char *name_for_im_tag(enum im_tag tag) {
     switch (tag) {
     case IM_UNCLASSIFIED:
@@ -598,7 +1172,40 @@ const char *name_for_im_tag(enum im_tag tag) {
         return "fiber";
     case IM_REDUCER_MAP:
         return "reducer map";
+    case IM_USER:
+        return "user";
     default:
         return "unknown";
     }
 }
+
+//=========================================================
+// Public interface
+//=========================================================
+
+/* The worker whose free lists serve the calling thread.  Outside of a
+   Cilkified region this is the worker that last exited one, as for
+   reducer views. */
+static inline __cilkrts_worker *user_alloc_worker(void) {
+#if INLINE_ALL_TLS
+    __cilkrts_worker *w = tls_worker;
+#else
+    __cilkrts_worker *w = __cilkrts_get_tls_worker();
+#endif
+    if (!w) {
+        global_state *g = default_cilkrts;
+        if (!g)
+            cilkrts_bug(NULL, "Worker allocation before the runtime started");
+        w = g->workers[g->exiting_worker];
+    }
+    return w;
+}
+
+void *__cilkrts_worker_malloc(size_t size) {
+    return cilk_internal_malloc(user_alloc_worker(), size, IM_USER);
+}
+
+void __cilkrts_worker_free(void *ptr, size_t size) {
+    if (ptr)
+        cilk_internal_free(user_alloc_worker(), ptr, size, IM_USER);
+}
@@ -13,6 +13,7 @@ enum im_tag {
     IM_CLOSURE,
     IM_FIBER,
     IM_REDUCER_MAP,
+    IM_USER, /* __cilkrts_worker_malloc */
     IM_NUM_TAGS
 };
 
@@ -41,11 +42,14 @@ CHEETAH_INTERNAL void
 cilk_internal_malloc_per_worker_destroy(__cilkrts_worker *w);
 CHEETAH_INTERNAL void
 cilk_internal_malloc_per_worker_terminate(__cilkrts_worker *w);
-__attribute__((alloc_size(2), assume_aligned(32), malloc))
+__attribute__((alloc_size(2), assume_aligned(CILK_CACHE_LINE), malloc))
 CHEETAH_INTERNAL void *
 cilk_internal_malloc(__cilkrts_worker *w, size_t size, enum im_tag tag);
 CHEETAH_INTERNAL void cilk_internal_free(__cilkrts_worker *w, void *p,
                                          size_t size, enum im_tag tag);
+/* Return cached memory beyond the high-water marks to the system. */
+CHEETAH_INTERNAL void cilk_internal_malloc_per_worker_trim(__cilkrts_worker *w);
+CHEETAH_INTERNAL size_t cilk_internal_malloc_global_trim(struct global_state *g);
 /* Release memory to the global pool after workers have stopped. */
 CHEETAH_INTERNAL void cilk_internal_free_global(struct global_state *, void *p,
                                                 size_t size, enum im_tag tag);
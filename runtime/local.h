@@ -2,6 +2,28 @@
 #define _CILK_LOCAL_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <stdatomic.h> /* must follow stdbool.h */
+
+#include "rts-config.h"
+
+/* A reducer map merge whose reductions idle workers may help perform.
+   The owner fills in the pairs and opens the job; helpers claim pairs in
+   blocks of grain.  The owner closes the job once every pair
+   is claimed and waits for the helpers to leave before reusing it. */
+struct reducer_merge_job {
+    _Atomic bool open;
+    _Atomic unsigned int helpers; // workers inside the job
+    _Atomic size_t next;          // next pair to claim
+    size_t num_pairs;
+    size_t grain;    // pairs claimed at once
+    bool into_right; // the right-hand views belong to the left map
+    bool keep;       // reset the right-hand views instead of freeing them
+    struct view_info **pairs; // this_map and other_map view of each pair
+    size_t cap;
+};
 
 struct local_state {
     struct __cilkrts_stack_frame **shadow_stack;
@@ -15,7 +37,14 @@ struct local_state {
     struct cilk_fiber_pool fiber_pool;
     struct cilk_im_desc im_desc;
     struct cilk_fiber *fiber_to_free;
+    struct cilkred_map *map_cache; // destroyed reducer maps for reuse
+    unsigned int map_cache_size;
+    unsigned int id_cache_size;
+    uint32_t id_cache[REDUCER_ID_CACHE_SIZE]; // free reducer IDs, sorted
     struct sched_stats stats;
+    // Polled by thieves, so kept off the cache lines above.
+    char merge_pad[CILK_CACHE_LINE];
+    struct reducer_merge_job merge_job;
 };
 
 #endif /* _CILK_LOCAL_H */
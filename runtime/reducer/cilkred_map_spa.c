@@ -1,6 +1,40 @@
 #include "cilkred_map.h"
+#include "global.h"
+#include "local.h"
 
+#include <assert.h>
 #include <stdatomic.h>
+#include <string.h>
+
+static_assert(sizeof(struct spa_log_page) <= SPA_PAGE_SIZE,
+              "reducer map log page is too large");
+static_assert(SPA_PAGE_VINFO * sizeof(ViewInfo) == SPA_PAGE_SIZE,
+              "reducer map page is not a whole number of views");
+
+// Layouts read by __cilkrts_hyper_lookup_inline.
+static_assert(HYPER_ID_VALID == __CILKRTS_HYPER_ID_VALID &&
+                  SPA_PAGE_VINFO == __CILKRTS_HYPER_PAGE_VIEWS,
+              "inline lookup constants do not match the reducer map");
+static_assert(sizeof(ViewInfo) == sizeof(__cilkrts_hyper_view) &&
+                  offsetof(ViewInfo, val) ==
+                      offsetof(__cilkrts_hyper_view, __val) &&
+                  offsetof(ViewInfo, key) ==
+                      offsetof(__cilkrts_hyper_view, __key),
+              "ViewInfo does not match __cilkrts_hyper_view");
+static_assert(sizeof(struct spa_page) == sizeof(__cilkrts_hyper_page) &&
+                  offsetof(struct spa_page, vinfo) ==
+                      offsetof(__cilkrts_hyper_page, __views) &&
+                  offsetof(struct spa_page, num_of_vinfo) ==
+                      offsetof(__cilkrts_hyper_page, __num_views),
+              "spa_page does not match __cilkrts_hyper_page");
+static_assert(sizeof(bool) == 1 &&
+                  offsetof(cilkred_map, num_of_pages) ==
+                      offsetof(__cilkrts_hyper_table, __num_pages) &&
+                  offsetof(cilkred_map, merging) ==
+                      offsetof(__cilkrts_hyper_table, __merging) &&
+                  offsetof(cilkred_map, pages) ==
+                      offsetof(__cilkrts_hyper_table, __pages),
+              "cilkred_map does not begin with __cilkrts_hyper_table");
 
 // =================================================================
 // small helper functions
@@ -36,40 +70,150 @@ static inline void clear_view(ViewInfo *view) {
 // helper functions that operate on a SPA map
 // =================================================================
 
-void cilkred_map_log_id(__cilkrts_worker *const w, cilkred_map *this_map,
-                        hyper_id_t id) {
-    CILK_ASSERT(w, this_map->num_of_logs <= ((this_map->spa_cap / 2) + 1));
-    CILK_ASSERT(w, this_map->num_of_vinfo <= this_map->spa_cap);
+/* Capacity of a map that can hold id, doubling from cap. */
+static hyper_id_t grown_cap(__cilkrts_worker *const w, hyper_id_t cap,
+                            hyper_id_t id) {
+    CILK_ASSERT(w, cap > 0 && id < HYPER_ID_VALID);
+    while (cap <= id)
+        cap *= 2;
+    return cap;
+}
+
+/* Raise the capacity of the map so that it can hold id.  Only the log
+   limit depends on the capacity; pages are allocated on first use. */
+static void cilkred_map_grow(__cilkrts_worker *const w, cilkred_map *this_map,
+                             hyper_id_t id) {
+    hyper_id_t old_cap = this_map->spa_cap;
+    hyper_id_t cap = grown_cap(w, old_cap, id);
+
+    // A log that overflowed stays invalid until the map is empty.
+    if (this_map->num_of_logs > old_cap / 2)
+        this_map->num_of_logs = cap / 2 + 1;
+    this_map->spa_cap = cap;
+
+    cilkrts_alert(REDUCE, w, "grew reducer map %p from %lu to %lu",
+                  (void *)this_map, (unsigned long)old_cap,
+                  (unsigned long)cap);
+}
+
+static void *alloc_spa_page(__cilkrts_worker *const w) {
+    void *page = cilk_aligned_alloc(SPA_PAGE_SIZE, SPA_PAGE_SIZE);
+    if (!page)
+        cilkrts_bug(w, "Unable to allocate reducer map page");
+    memset(page, 0, SPA_PAGE_SIZE);
+    return page;
+}
 
-    if (this_map->num_of_vinfo == this_map->spa_cap) {
-        cilkrts_bug(w, "SPA resize not supported yet! (vinfo = spa_cap = %lu)",
-                    (unsigned long)this_map->spa_cap);
+static ViewInfo *spa_vinfo_alloc(__cilkrts_worker *const w,
+                                 cilkred_map *this_map, hyper_id_t id) {
+    if (id >= this_map->spa_cap)
+        cilkred_map_grow(w, this_map, id);
+
+    hyper_id_t page = id / SPA_PAGE_VINFO;
+    if (page >= this_map->num_of_pages) {
+        hyper_id_t old_pages = this_map->num_of_pages;
+        hyper_id_t num_pages = old_pages ? old_pages * 2 : 1;
+        while (num_pages <= page)
+            num_pages *= 2;
+        struct spa_page *pages = (struct spa_page *)realloc(
+            this_map->pages, num_pages * sizeof(struct spa_page));
+        if (!pages)
+            cilkrts_bug(w, "Unable to grow reducer map to %lu pages",
+                        (unsigned long)num_pages);
+        memset(pages + old_pages, 0,
+               (num_pages - old_pages) * sizeof(struct spa_page));
+        this_map->pages = pages;
+        this_map->num_of_pages = num_pages;
     }
+    if (!this_map->pages[page].vinfo)
+        this_map->pages[page].vinfo = (ViewInfo *)alloc_spa_page(w);
+
+    return &this_map->pages[page].vinfo[id % SPA_PAGE_VINFO];
+}
+
+static void spa_log_id(__cilkrts_worker *const w, cilkred_map *this_map,
+                       hyper_id_t id) {
+    CILK_ASSERT(w, this_map->num_of_logs <= ((this_map->spa_cap / 2) + 1));
+    CILK_ASSERT(w, this_map->num_of_vinfo < this_map->spa_cap);
+    CILK_ASSERT(w, id < this_map->spa_cap);
+    CILK_ASSERT(w, cilkred_map_vinfo(this_map, id) != NULL);
 
     if (this_map->num_of_logs < (this_map->spa_cap / 2)) {
-        this_map->log[this_map->num_of_logs++] = id;
+        hyper_id_t slot = this_map->num_of_logs % SPA_PAGE_LOG;
+        if (slot == 0) {
+            // Move to the next log page, reusing one left from before.
+            struct spa_log_page *next = this_map->num_of_logs == 0
+                                            ? this_map->log
+                                            : this_map->log_tail->next;
+            if (!next) {
+                next = (struct spa_log_page *)alloc_spa_page(w);
+                if (this_map->num_of_logs == 0)
+                    this_map->log = next;
+                else
+                    this_map->log_tail->next = next;
+            }
+            this_map->log_tail = next;
+        }
+        this_map->log_tail->id[slot] = id;
+        this_map->num_of_logs++;
     } else if (this_map->num_of_logs == (this_map->spa_cap / 2)) {
         this_map->num_of_logs++; // invalidate the log
     }
 
+    this_map->pages[id / SPA_PAGE_VINFO].num_of_vinfo++;
     this_map->num_of_vinfo++;
 }
 
-void cilkred_map_unlog_id(__cilkrts_worker *const w, cilkred_map *this_map,
-                          hyper_id_t id) {
+static void spa_unlog_id(__cilkrts_worker *const w, cilkred_map *this_map,
+                         hyper_id_t id) {
     CILK_ASSERT(w, this_map->num_of_logs <= ((this_map->spa_cap / 2) + 1));
     CILK_ASSERT(w, this_map->num_of_vinfo <= this_map->spa_cap);
     CILK_ASSERT(w, id < this_map->spa_cap);
 
-    this_map->vinfo[id].key = NULL;
-    this_map->vinfo[id].val = NULL;
+    ViewInfo *vinfo = cilkred_map_vinfo(this_map, id);
+    CILK_ASSERT(w, vinfo != NULL);
+    vinfo->key = NULL;
+    vinfo->val = NULL;
 
+    this_map->pages[id / SPA_PAGE_VINFO].num_of_vinfo--;
     this_map->num_of_vinfo--;
     if (this_map->num_of_vinfo == 0) {
         this_map->num_of_logs = 0; // now we can reset the log
     }
 }
 
+static ViewInfo *spa_lookup(cilkred_map *this_map, hyper_id_t id) {
+    ViewInfo *ret = cilkred_map_vinfo(this_map, id);
+    if (ret == NULL || (ret->key == NULL && ret->val == NULL)) {
+        return NULL;
+    }
+    return ret;
+}
+
+/* Raise the capacity of this_map to that of other_map.  The maps may have
+   been created before and after the ID manager raised its capacity; keep
+   the log limit of the larger map.  Pages never move. */
+static void spa_reserve(__cilkrts_worker *const w, cilkred_map *this_map,
+                        cilkred_map *other_map) {
+    if (other_map->spa_cap > this_map->spa_cap)
+        cilkred_map_grow(w, this_map, other_map->spa_cap - 1);
+}
+
+ViewInfo *cilkred_map_vinfo_alloc(__cilkrts_worker *const w,
+                                  cilkred_map *this_map, hyper_id_t id) {
+    return this_map->ops->vinfo_alloc(w, this_map, id);
+}
+
+void cilkred_map_log_id(__cilkrts_worker *const w, cilkred_map *this_map,
+                        hyper_id_t id) {
+    this_map->ops->log_id(w, this_map, id);
+}
+
+void cilkred_map_unlog_id(__cilkrts_worker *const w, cilkred_map *this_map,
+                          hyper_id_t id) {
+    this_map->ops->unlog_id(w, this_map, id);
+}
+
 /** @brief Return element mapped to 'key' or null if not found. */
 ViewInfo *cilkred_map_lookup(cilkred_map *this_map,
                              __cilkrts_hyperobject_base *key) {
@@ -77,16 +221,41 @@ ViewInfo *cilkred_map_lookup(cilkred_map *this_map,
     if (__builtin_expect(!(id & HYPER_ID_VALID), 0)) {
         return NULL;
     }
-    id &= ~HYPER_ID_VALID;
-    if (id >= this_map->spa_cap) {
-        return NULL; /* TODO: grow map */
-    }
-    ViewInfo *ret = this_map->vinfo + id;
-    if (ret->key == NULL && ret->val == NULL) {
-        return NULL;
+    return this_map->ops->lookup(this_map, id & ~HYPER_ID_VALID);
+}
+
+/* Only the entries named in the log can still be set, so clear those.  If
+   the log overflowed, clear the pages that held views instead. */
+static void spa_clear(cilkred_map *h) {
+    if (h->num_of_logs <= h->spa_cap / 2) {
+        struct spa_log_page *log = h->log;
+        for (hyper_id_t i = 0; i < h->num_of_logs; ++i) {
+            if (i > 0 && i % SPA_PAGE_LOG == 0)
+                log = log->next;
+            hyper_id_t id = log->id[i % SPA_PAGE_LOG];
+            struct spa_page *page = &h->pages[id / SPA_PAGE_VINFO];
+            page->num_of_vinfo = 0;
+            page->vinfo[id % SPA_PAGE_VINFO].key = NULL;
+            page->vinfo[id % SPA_PAGE_VINFO].val = NULL;
+        }
+    } else {
+        for (hyper_id_t p = 0; p < h->num_of_pages; ++p) {
+            struct spa_page *page = &h->pages[p];
+            if (page->num_of_vinfo != 0) {
+                memset(page->vinfo, 0, SPA_PAGE_SIZE);
+                page->num_of_vinfo = 0;
+            }
+        }
     }
+    h->num_of_logs = 0;
+}
 
-    return ret;
+/* Reset a map taken from the cache. */
+static void cilkred_map_clear(cilkred_map *h) {
+    h->ops->clear(h);
+    h->num_of_vinfo = 0;
+    h->merging = false;
+    h->is_leftmost = false;
 }
 
 /**
@@ -102,26 +271,86 @@ cilkred_map *cilkred_map_make_map(__cilkrts_worker *w, size_t size) {
     CILK_ASSERT_G(w);
     CILK_ASSERT(w, size > 0 && (hyper_id_t)size == size);
 
-    cilkred_map *h =
-        (cilkred_map *)cilk_internal_malloc(w, sizeof(*h), IM_REDUCER_MAP);
+    local_state *l = w->l;
+    cilkred_map *h = l->map_cache;
+    if (h) {
+        l->map_cache = h->next_free;
+        --l->map_cache_size;
+        cilkred_map_clear(h);
+        h->chain_next = NULL;
+        h->chain_tail = NULL;
+        if (h->spa_cap < size)
+            h->spa_cap = size;
+        cilkrts_alert(REDUCE, w, "reused reducer map size %zu %p", size,
+                      (void *)h);
+        return h;
+    }
+
+    h = (cilkred_map *)cilk_internal_malloc(w, sizeof(*h), IM_REDUCER_MAP);
 
     // MAK: w is not NULL
     h->spa_cap = size;
     h->num_of_vinfo = 0;
     h->num_of_logs = 0;
+    h->num_of_pages = 0;
     h->merging = false;
-    h->vinfo = (ViewInfo *)calloc(size, sizeof(ViewInfo));
-    h->log = (hyper_id_t *)calloc(size / 2, sizeof(hyper_id_t));
-
-    cilkrts_alert(REDUCE, w, "created reducer map size %zu %p", size,
-                  (void *)h);
+    h->is_leftmost = false;
+    h->next_free = NULL;
+    h->chain_next = NULL;
+    h->chain_tail = NULL;
+    h->log = NULL;
+    h->log_tail = NULL;
+    h->pages = NULL;
+    h->ops = w->g->options.reducer_map == REDUCER_MAP_HASH
+                 ? &cilkred_map_hash_ops
+                 : &cilkred_map_spa_ops;
+    h->hash_tags = NULL;
+    h->hash_slots = NULL;
+    h->hash_cap = 0;
+    h->hash_used = 0;
+
+    cilkrts_alert(REDUCE, w, "created %s reducer map size %zu %p",
+                  h->ops->name, size, (void *)h);
 
     return h;
 }
 
+static void spa_release(cilkred_map *h) {
+    for (hyper_id_t p = 0; p < h->num_of_pages; ++p)
+        free(h->pages[p].vinfo);
+    free(h->pages);
+    h->pages = NULL;
+    h->num_of_pages = 0;
+    struct spa_log_page *log = h->log;
+    while (log) {
+        struct spa_log_page *next = log->next;
+        free(log);
+        log = next;
+    }
+    h->log = NULL;
+}
+
+static bool spa_holds_views(cilkred_map *h) {
+    for (hyper_id_t p = 0; p < h->num_of_pages; ++p) {
+        ViewInfo *vinfo = h->pages[p].vinfo;
+        for (hyper_id_t i = 0; vinfo && i < SPA_PAGE_VINFO; ++i)
+            if (vinfo[i].val)
+                return true;
+    }
+    return false;
+}
+
+static void cilkred_map_free(__cilkrts_worker *w, cilkred_map *h) {
+    h->ops->release(h);
+    cilk_internal_free(w, h, sizeof(*h), IM_REDUCER_MAP);
+
+    cilkrts_alert(REDUCE, w, "freed reducer map %p", (void *)h);
+}
+
 /**
  * Destroy a reducer map.  The map must have been allocated from the worker's
  * global context and should have been allocated from the same worker.
+ * The map is kept in the worker's map cache for reuse if there is room.
  *
  * @param w __cilkrts_worker the cilkred_map was created for.
  * @param h The cilkred_map to be deallocated.
@@ -130,17 +359,223 @@ void cilkred_map_destroy_map(__cilkrts_worker *w, cilkred_map *h) {
     if (!h) {
         return;
     }
-    if (DEBUG_ENABLED(REDUCER)) {
-        for (hyper_id_t i = 0; i < h->spa_cap; ++i)
-            CILK_ASSERT(w, !h->vinfo[i].val);
+    if (DEBUG_ENABLED(REDUCER))
+        CILK_ASSERT(w, !h->ops->holds_views(h));
+    local_state *l = w->l;
+    if (l->map_cache_size < REDUCER_MAP_CACHE_SIZE) {
+        // The map is cleared when it is reused.
+        h->next_free = l->map_cache;
+        l->map_cache = h;
+        ++l->map_cache_size;
+        cilkrts_alert(REDUCE, w, "cached reducer map %p", (void *)h);
+        return;
     }
-    free(h->vinfo);
-    h->vinfo = NULL;
-    free(h->log);
-    h->log = NULL;
-    cilk_internal_free(w, h, sizeof(*h), IM_REDUCER_MAP);
+    cilkred_map_free(w, h);
+}
 
-    cilkrts_alert(REDUCE, w, "freed reducer map %p", (void *)h);
+void cilkred_map_cache_drain(__cilkrts_worker *w) {
+    local_state *l = w->l;
+    while (l->map_cache) {
+        cilkred_map *h = l->map_cache;
+        l->map_cache = h->next_free;
+        cilkred_map_free(w, h);
+    }
+    l->map_cache_size = 0;
+    free(l->merge_job.pairs);
+    l->merge_job.pairs = NULL;
+    l->merge_job.cap = 0;
+}
+
+/* Reset a view to the identity, keeping its memory. */
+static inline void reset_view(ViewInfo *view) {
+    __cilkrts_hyperobject_base *key = view->key;
+    if (key->__c_monoid.destroy_fn)
+        key->__c_monoid.destroy_fn(key, view->val);
+    key->__c_monoid.identity_fn(key, view->val);
+}
+
+/* Reduce other_vinfo into this_vinfo, which hold views of the same
+   reducer, and clear other_vinfo or, if keep is set, reset it. */
+static inline void reduce_views(ViewInfo *this_vinfo, ViewInfo *other_vinfo,
+                                bool into_right, bool keep) {
+    __cilkrts_hyperobject_base *key = other_vinfo->key;
+    if (into_right) { // other_map is the left val
+        swap_vals(other_vinfo, this_vinfo);
+    }
+    // updated val is stored back into the left
+    key->__c_monoid.reduce_fn(key, this_vinfo->val, other_vinfo->val);
+    if (keep)
+        reset_view(other_vinfo);
+    else
+        clear_view(other_vinfo);
+}
+
+/* Prepare the worker's merge job for up to n reductions. */
+static struct reducer_merge_job *merge_job_begin(__cilkrts_worker *w,
+                                                 size_t n, size_t grain,
+                                                 bool into_right, bool keep) {
+    struct reducer_merge_job *job = &w->l->merge_job;
+    CILK_ASSERT(w, job->num_pairs == 0);
+    if (job->cap < 2 * n) {
+        free(job->pairs);
+        job->cap = 4 * n;
+        job->pairs = (ViewInfo **)malloc(job->cap * sizeof(ViewInfo *));
+        if (!job->pairs)
+            cilkrts_bug(w, "Unable to allocate reducer merge job");
+    }
+    job->grain = grain;
+    job->into_right = into_right;
+    job->keep = keep;
+    return job;
+}
+
+static inline void merge_job_add(__cilkrts_worker *w,
+                                 struct reducer_merge_job *job,
+                                 ViewInfo *this_vinfo, ViewInfo *other_vinfo) {
+    CILK_ASSERT(w, 2 * job->num_pairs < job->cap);
+    job->pairs[2 * job->num_pairs] = this_vinfo;
+    job->pairs[2 * job->num_pairs + 1] = other_vinfo;
+    ++job->num_pairs;
+}
+
+/* Merge the view at other_vinfo into this_map.  If job is not NULL the
+   reduction is added to the job instead of performed. */
+static inline void merge_view(cilkred_map *this_map, __cilkrts_worker *w,
+                              ViewInfo *other_vinfo, hyper_id_t vindex,
+                              merge_kind kind, struct reducer_merge_job *job) {
+    __cilkrts_hyperobject_base *key = other_vinfo->key;
+    if (key == NULL) // logged, then removed
+        return;
+    ViewInfo *this_vinfo = cilkred_map_vinfo_alloc(w, this_map, vindex);
+
+    if (this_vinfo->key == NULL && this_map->is_leftmost) {
+        // The leftmost strand has not referenced the reducer.  Unless
+        // other_vinfo already holds it, install the leftmost view so that
+        // the right view is reduced into it.
+        void *leftmost = (char *)key + (ptrdiff_t)key->__view_offset;
+        if (other_vinfo->val != leftmost) {
+            CILK_ASSERT(w, this_vinfo->val == NULL);
+            this_vinfo->key = key;
+            this_vinfo->val = leftmost;
+            cilkred_map_log_id(w, this_map, vindex);
+        }
+    }
+
+    if (this_vinfo->key != NULL) {
+        CILK_ASSERT(w, key == this_vinfo->key);
+        if (job) {
+            merge_job_add(w, job, this_vinfo, other_vinfo);
+        } else {
+            reduce_views(this_vinfo, other_vinfo, kind == MERGE_INTO_RIGHT,
+                         false);
+        }
+    } else { // the 'this_map' page does not contain view
+        CILK_ASSERT(w, this_vinfo->val == NULL);
+        // transfer the key / val over
+        swap_views(other_vinfo, this_vinfo);
+        cilkred_map_log_id(w, this_map, vindex);
+    }
+}
+
+/* Claim blocks of the job's reductions and perform them until none are
+   left. */
+static void merge_job_drain(struct reducer_merge_job *job) {
+    size_t n = job->num_pairs, grain = job->grain;
+    while (true) {
+        size_t begin =
+            atomic_fetch_add_explicit(&job->next, grain, memory_order_relaxed);
+        if (begin >= n)
+            return;
+        size_t end = n - begin > grain ? begin + grain : n;
+        for (size_t i = begin; i < end; ++i)
+            reduce_views(job->pairs[2 * i], job->pairs[2 * i + 1],
+                         job->into_right, job->keep);
+    }
+}
+
+/* Perform the reductions collected in the worker's merge job, sharing
+   them with idle workers if there are at least threshold of them. */
+static void merge_job_run(__cilkrts_worker *w, struct reducer_merge_job *job,
+                          size_t threshold) {
+    bool shared = threshold > 0 && job->num_pairs >= threshold &&
+                  w->g->nworkers > 1;
+
+    atomic_store_explicit(&job->next, 0, memory_order_relaxed);
+    if (shared) {
+        cilkrts_alert(REDUCE, w, "sharing %zu reductions", job->num_pairs);
+        atomic_store_explicit(&job->open, true, memory_order_release);
+    }
+    merge_job_drain(job);
+    if (shared) {
+        // Every reduction has been claimed.  Wait for helpers still
+        // performing theirs; see cilkred_map_merge_help.
+        atomic_store_explicit(&job->open, false, memory_order_seq_cst);
+        while (atomic_load_explicit(&job->helpers, memory_order_seq_cst)) {
+#ifdef __SSE__
+            __builtin_ia32_pause();
+#endif
+#ifdef __aarch64__
+            __builtin_arm_yield();
+#endif
+        }
+    }
+    job->num_pairs = 0;
+}
+
+/* The reductions run on w, whose TLS worker and reducer map are not the
+   victim's, so sharing is off unless CILK_MERGE_THRESHOLD is set.  Reduce
+   functions must then not look up reducer views. */
+bool cilkred_map_merge_help(__cilkrts_worker *w, __cilkrts_worker *victim) {
+    struct reducer_merge_job *job = &victim->l->merge_job;
+    if (!atomic_load_explicit(&job->open, memory_order_relaxed))
+        return false;
+    // Pairs with the owner closing the job: either the owner sees this
+    // helper or the helper sees the job closed.
+    atomic_fetch_add_explicit(&job->helpers, 1, memory_order_seq_cst);
+    bool open = atomic_load_explicit(&job->open, memory_order_seq_cst);
+    if (open) {
+        cilkrts_alert(REDUCE, w, "helping merge on worker %u", victim->self);
+        merge_job_drain(job);
+    }
+    atomic_fetch_sub_explicit(&job->helpers, 1, memory_order_release);
+    return open;
+}
+
+/* Merge the views of other_map named in its log, or if the log overflowed,
+   those of the pages that hold views. */
+static void spa_merge_views(cilkred_map *this_map, __cilkrts_worker *w,
+                            cilkred_map *other_map, merge_kind kind,
+                            struct reducer_merge_job *job) {
+    if (other_map->num_of_logs <= (other_map->spa_cap / 2)) {
+        struct spa_log_page *log = other_map->log;
+        hyper_id_t i;
+
+        for (i = 0; i < other_map->num_of_logs; i++) {
+            if (i > 0 && i % SPA_PAGE_LOG == 0)
+                log = log->next;
+            hyper_id_t vindex = log->id[i % SPA_PAGE_LOG];
+            merge_view(this_map, w, cilkred_map_vinfo(other_map, vindex),
+                       vindex, kind, job);
+        }
+
+    } else {
+        // Scan only the pages that hold views.
+        hyper_id_t p;
+        for (p = 0; p < other_map->num_of_pages; p++) {
+            struct spa_page *page = &other_map->pages[p];
+            if (page->num_of_vinfo == 0)
+                continue;
+            hyper_id_t i;
+            for (i = 0; i < SPA_PAGE_VINFO; i++) {
+                if (page->vinfo[i].key != NULL) {
+                    merge_view(this_map, w, &page->vinfo[i],
+                               p * SPA_PAGE_VINFO + i, kind, job);
+                }
+            }
+            page->num_of_vinfo = 0;
+        }
+    }
+    // Keep the log so that reusing other_map clears only these entries.
 }
 
 /* This function is responsible for freeing other_map. */
@@ -154,67 +589,33 @@ void cilkred_map_merge(cilkred_map *this_map, __cilkrts_worker *w,
     other_map->merging = true;
 
     // Merging to the leftmost view is a special case because every leftmost
-    // element must be initialized before the merge.
-    // CILK_ASSERT(w, !other_map->is_leftmost /* || kind == MERGE_UNORDERED */);
-    // bool merge_to_leftmost = (this_map->is_leftmost);
+    // element must be initialized before the merge; see merge_view.
+    CILK_ASSERT(w, !other_map->is_leftmost /* || kind == MERGE_UNORDERED */);
+    CILK_ASSERT(w, !this_map->is_leftmost || kind == MERGE_INTO_LEFT);
 
     if (other_map->num_of_vinfo == 0) {
+        this_map->merging = false;
         cilkred_map_destroy_map(w, other_map);
         return;
     }
 
-    if (other_map->num_of_logs <= (other_map->spa_cap / 2)) {
-        hyper_id_t i;
-
-        for (i = 0; i < other_map->num_of_logs; i++) {
-            hyper_id_t vindex = other_map->log[i];
-            __cilkrts_hyperobject_base *key = other_map->vinfo[vindex].key;
-
-            if (this_map->vinfo[vindex].key != NULL) {
-                CILK_ASSERT(w, key == this_map->vinfo[vindex].key);
-                if (kind == MERGE_INTO_RIGHT) { // other_map is the left val
-                    swap_vals(&other_map->vinfo[vindex],
-                              &this_map->vinfo[vindex]);
-                }
-                // updated val is stored back into the left
-                key->__c_monoid.reduce_fn(key, this_map->vinfo[vindex].val,
-                                          other_map->vinfo[vindex].val);
-                clear_view(&other_map->vinfo[vindex]);
-            } else {
-                CILK_ASSERT(w, this_map->vinfo[vindex].val == NULL);
-                swap_views(&other_map->vinfo[vindex], &this_map->vinfo[vindex]);
-                cilkred_map_log_id(w, this_map, vindex);
-            }
-        }
+    this_map->ops->reserve(w, this_map, other_map);
 
-    } else {
-        hyper_id_t i;
-        for (i = 0; i < other_map->spa_cap; i++) {
-            if (other_map->vinfo[i].key != NULL) {
-                __cilkrts_hyperobject_base *key = other_map->vinfo[i].key;
-
-                if (this_map->vinfo[i].key != NULL) {
-                    CILK_ASSERT(w, key == this_map->vinfo[i].key);
-                    if (kind == MERGE_INTO_RIGHT) { // other_map is the left val
-                        swap_vals(&other_map->vinfo[i], &this_map->vinfo[i]);
-                    }
-                    // updated val is stored back into the left
-                    key->__c_monoid.reduce_fn(key, this_map->vinfo[i].val,
-                                              other_map->vinfo[i].val);
-                    clear_view(&other_map->vinfo[i]);
-                } else { // the 'this_map' page does not contain view
-                    CILK_ASSERT(w, this_map->vinfo[i].val == NULL);
-                    // transfer the key / val over
-                    swap_views(&other_map->vinfo[i], &this_map->vinfo[i]);
-                    cilkred_map_log_id(w, this_map, i);
-                }
-            }
-        }
+    // A merge that may perform many reductions collects them first so
+    // that idle workers can share the work.
+    struct reducer_merge_job *job = NULL;
+    unsigned int threshold = w->g->options.merge_threshold;
+    if (threshold > 0 && other_map->num_of_vinfo >= threshold &&
+        w->g->nworkers > 1) {
+        job = merge_job_begin(w, other_map->num_of_vinfo, REDUCER_MERGE_GRAIN,
+                              kind == MERGE_INTO_RIGHT, false);
     }
+
+    this_map->ops->merge_views(this_map, w, other_map, kind, job);
+    if (job)
+        merge_job_run(w, job, threshold);
     other_map->num_of_vinfo = 0;
-    other_map->num_of_logs = 0;
 
-    // this_map->is_leftmost = this_map->is_leftmost || other_map->is_leftmost;
     this_map->merging = false;
     other_map->merging = false;
     cilkred_map_destroy_map(w, other_map);
@@ -232,7 +633,27 @@ size_t cilkred_map_num_views(cilkred_map *this_map) {
 }
 
 /** @brief Is the cilkred_map leftmost */
-bool cilkred_map_is_leftmost(cilkred_map *this_map) { return false; }
+bool cilkred_map_is_leftmost(cilkred_map *this_map) {
+    return this_map->is_leftmost;
+}
+
+/** @brief Mark the cilkred_map as holding the leftmost views */
+void cilkred_map_set_leftmost(cilkred_map *this_map) {
+    this_map->is_leftmost = true;
+}
+
+const struct cilkred_map_ops cilkred_map_spa_ops = {
+    .name = "spa",
+    .lookup = spa_lookup,
+    .vinfo_alloc = spa_vinfo_alloc,
+    .log_id = spa_log_id,
+    .unlog_id = spa_unlog_id,
+    .reserve = spa_reserve,
+    .merge_views = spa_merge_views,
+    .clear = spa_clear,
+    .release = spa_release,
+    .holds_views = spa_holds_views,
+};
 
 #if COMM_REDUCER
 
@@ -243,17 +664,37 @@ ViewInfo *com_cilkred_map_lookup(com_cilkred_map *this_map,
         return NULL;
     }
     id &= ~HYPER_ID_VALID;
-    if (id >= this_map->spa_cap) {
-        return NULL; /* TODO: grow map */
-    }
-    ViewInfo *ret = this_map->vinfo + id;
-    if (ret->key == NULL && ret->val == NULL) {
+    ViewInfo *ret = com_cilkred_map_vinfo(this_map, id);
+    if (ret == NULL || (ret->key == NULL && ret->val == NULL)) {
         return NULL;
     }
 
     return ret;
 }
 
+ViewInfo *com_cilkred_map_vinfo_alloc(__cilkrts_worker *const w,
+                                      com_cilkred_map *this_map,
+                                      hyper_id_t id) {
+    hyper_id_t page = id / SPA_PAGE_VINFO;
+    if (page >= this_map->num_of_pages) {
+        hyper_id_t old_pages = this_map->num_of_pages;
+        hyper_id_t num_pages = grown_cap(w, old_pages, page);
+        ViewInfo **pages = (ViewInfo **)realloc(
+            this_map->pages, num_pages * sizeof(ViewInfo *));
+        if (!pages)
+            cilkrts_bug(w, "Unable to grow reducer map to %lu pages",
+                        (unsigned long)num_pages);
+        memset(pages + old_pages, 0,
+               (num_pages - old_pages) * sizeof(ViewInfo *));
+        this_map->pages = pages;
+        this_map->num_of_pages = num_pages;
+    }
+    if (!this_map->pages[page])
+        this_map->pages[page] = (ViewInfo *)alloc_spa_page(w);
+
+    return &this_map->pages[page][id % SPA_PAGE_VINFO];
+}
+
 com_cilkred_map *com_cilkred_map_make_map(__cilkrts_worker *w, size_t size) {
     CILK_ASSERT_G(w);
     CILK_ASSERT(w, size > 0 && (hyper_id_t)size == size);
@@ -261,10 +702,36 @@ com_cilkred_map *com_cilkred_map_make_map(__cilkrts_worker *w, size_t size) {
     com_cilkred_map *h = (com_cilkred_map *)malloc(sizeof(*h));
 
     // MAK: w is not NULL
-    h->spa_cap = size;
-    h->vinfo = (ViewInfo *)calloc(size, sizeof(ViewInfo));
+    // Pages are allocated on first use.
+    h->num_of_pages = (size + SPA_PAGE_VINFO - 1) / SPA_PAGE_VINFO;
+    h->pages = (ViewInfo **)calloc(h->num_of_pages, sizeof(ViewInfo *));
 
     return h;
 }
 
+void com_cilkred_map_free(__cilkrts_worker *w, com_cilkred_map *this_map) {
+    for (hyper_id_t p = 0; p < this_map->num_of_pages; ++p) {
+        ViewInfo *page = this_map->pages[p];
+        if (!page)
+            continue;
+        if (DEBUG_ENABLED(REDUCER)) {
+            // Commutative reducers free every worker's view when destroyed.
+            for (hyper_id_t i = 0; i < SPA_PAGE_VINFO; ++i)
+                CILK_ASSERT(w, page[i].val == NULL);
+        }
+        free(page);
+    }
+    free(this_map->pages);
+    free(this_map);
+}
+
+/* Reduce views[1..n-1] into views[0] on the calling thread.  Idle workers
+   do not help: in a Cilkified region the owners of the views are not known
+   to be quiescent. */
+void com_cilkred_map_merge_views(__cilkrts_worker *w, ViewInfo **views,
+                                 size_t n, bool keep) {
+    for (size_t i = 1; i < n; ++i)
+        reduce_views(views[0], views[i], false, keep);
+}
+
 #endif
\ No newline at end of file
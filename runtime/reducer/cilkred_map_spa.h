@@ -24,22 +24,119 @@ typedef struct view_info {
     __cilkrts_hyperobject_base *key;
 } ViewInfo;
 
+/* The SPA is split into pages of SPA_PAGE_SIZE bytes.  A page of views or
+   of log entries is allocated the first time it is needed, so creating a
+   map costs the same regardless of the reducer limit. */
+#define SPA_PAGE_SIZE 4096
+#define SPA_PAGE_VINFO (SPA_PAGE_SIZE / sizeof(ViewInfo))
+#define SPA_PAGE_LOG ((SPA_PAGE_SIZE - sizeof(void *)) / sizeof(hyper_id_t))
+
+struct spa_page {
+    ViewInfo *vinfo;         // SPA_PAGE_VINFO entries, or NULL
+    hyper_id_t num_of_vinfo; // views in this page
+};
+
+struct spa_log_page {
+    struct spa_log_page *next;
+    hyper_id_t id[SPA_PAGE_LOG];
+};
+
+struct hash_slot;
+struct reducer_merge_job;
+
+/**
+ * Operations that depend on how a reducer map stores its views.  Every map
+ * of a program uses the same implementation, chosen when Cilk starts by
+ * CILK_REDUCER_MAP: "spa" (the default) for the sparse accumulator below,
+ * or "hash" for the open-addressing table in cilkred_map_hash.c, whose
+ * size follows the number of views rather than the largest reducer ID.
+ */
+struct cilkred_map_ops {
+    const char *name;
+    /** Return the entry for id, or NULL if id is not in the map. */
+    ViewInfo *(*lookup)(cilkred_map *this_map, hyper_id_t id);
+    /** Return the entry for id, adding an empty one if necessary. */
+    ViewInfo *(*vinfo_alloc)(__cilkrts_worker *const w, cilkred_map *this_map,
+                             hyper_id_t id);
+    /** Count the entry for id, which has just been filled in. */
+    void (*log_id)(__cilkrts_worker *const w, cilkred_map *this_map,
+                   hyper_id_t id);
+    /** Empty the entry for id. */
+    void (*unlog_id)(__cilkrts_worker *const w, cilkred_map *this_map,
+                     hyper_id_t id);
+    /** Make room for the views of other_map, so that merging it does not
+        move the entries of this_map. */
+    void (*reserve)(__cilkrts_worker *const w, cilkred_map *this_map,
+                    cilkred_map *other_map);
+    /** Pass each view of other_map to merge_view. */
+    void (*merge_views)(cilkred_map *this_map, __cilkrts_worker *w,
+                        cilkred_map *other_map, merge_kind kind,
+                        struct reducer_merge_job *job);
+    /** Empty the entries of a map taken from the cache. */
+    void (*clear)(cilkred_map *this_map);
+    /** Free the storage of the entries. */
+    void (*release)(cilkred_map *this_map);
+    /** Test whether any entry still holds a view. */
+    bool (*holds_views)(cilkred_map *this_map);
+};
+
+CHEETAH_INTERNAL extern const struct cilkred_map_ops cilkred_map_spa_ops;
+CHEETAH_INTERNAL extern const struct cilkred_map_ops cilkred_map_hash_ops;
+
 /**
  * Class that implements the map for reducers so we can find the
  * view for a strand.
  */
 struct cilkred_map {
+    // The first three fields are read by the inline lookup in user code
+    // and must match __cilkrts_hyper_table in cilk/hyperobject_base.h.
+    hyper_id_t num_of_pages; // length of pages, grows on demand
+    /** Set true if merging (for debugging purposes) */
+    bool merging;
+    // Page directory.  Pages never move once allocated.  A hash map has
+    // no pages, so the inline lookup always misses.
+    struct spa_page *pages;
+    const struct cilkred_map_ops *ops;
+
     hyper_id_t spa_cap;
     hyper_id_t num_of_vinfo; // max is spa_cap
     hyper_id_t num_of_logs;  // max is spa_cap / 2
-    /** Set true if merging (for debugging purposes) */
-    bool merging;
-    hyper_id_t *log;
-    // SPA structure, may be reallocated when entries are added or removed
-    ViewInfo *vinfo;
+    struct cilkred_map *next_free; // in the worker's map cache
+    // Maps awaiting reduction, in serial order; see DEFERRED_REDUCE.
+    struct cilkred_map *chain_next;
+    struct cilkred_map *chain_tail; // last map of the chain, set on its head
+    // Log pages are kept when the map empties and reused.
+    struct spa_log_page *log;
+    struct spa_log_page *log_tail;
+    // Holds the views of the leftmost strand, where the view of a reducer
+    // is the one at key + __view_offset.
+    bool is_leftmost;
+    // Table of a hash map: hash_cap tags followed by hash_cap slots.
+    uint8_t *hash_tags;
+    struct hash_slot *hash_slots;
+    hyper_id_t hash_cap;  // 0 or a power of 2
+    hyper_id_t hash_used; // slots holding an entry or a tombstone
 };
 typedef struct cilkred_map cilkred_map;
 
+/* Return the entry for id, or NULL if its page is not allocated.  This is
+   the fast path of a lookup in a SPA map; it always fails in a hash map. */
+static inline ViewInfo *cilkred_map_vinfo(cilkred_map *this_map,
+                                          hyper_id_t id) {
+    hyper_id_t page = id / SPA_PAGE_VINFO;
+    if (page >= this_map->num_of_pages || !this_map->pages[page].vinfo)
+        return NULL;
+    return &this_map->pages[page].vinfo[id % SPA_PAGE_VINFO];
+}
+
+/* Return the entry for id, adding it to the map if necessary.  The entry
+   is empty unless id is in the map.  Entries of a hash map move when it
+   grows, so the entry is valid only until the next entry is added, except
+   during a merge; see cilkred_map_ops.reserve. */
+CHEETAH_INTERNAL
+ViewInfo *cilkred_map_vinfo_alloc(__cilkrts_worker *const w,
+                                  cilkred_map *this_map, hyper_id_t id);
+
 CHEETAH_INTERNAL
 void cilkred_map_log_id(__cilkrts_worker *const w, cilkred_map *this_map,
                         hyper_id_t id);
@@ -48,8 +145,6 @@ void cilkred_map_unlog_id(__cilkrts_worker *const w, cilkred_map *this_map,
 
                           hyper_id_t id);
 
-/* Calling this function potentially invalidates any older ViewInfo pointers
-   from the same map. */
 CHEETAH_INTERNAL
 ViewInfo *cilkred_map_lookup(cilkred_map *this_map,
                              __cilkrts_hyperobject_base *key);
@@ -68,6 +163,7 @@ cilkred_map *cilkred_map_make_map(__cilkrts_worker *w, size_t size);
 /**
  * Destroy a reducer map.  The map must have been allocated from the worker's
  * global context and should have been allocated from the same worker.
+ * The map is kept in the worker's map cache for reuse if there is room.
  *
  * @param w __cilkrts_worker the cilkred_map was created for.
  * @param h The cilkred_map to be deallocated.
@@ -75,13 +171,28 @@ cilkred_map *cilkred_map_make_map(__cilkrts_worker *w, size_t size);
 CHEETAH_INTERNAL
 void cilkred_map_destroy_map(__cilkrts_worker *w, cilkred_map *h);
 
+/** Free the reducer maps in the worker's map cache and its merge buffer. */
+CHEETAH_INTERNAL
+void cilkred_map_cache_drain(__cilkrts_worker *w);
+
 /**
- * Merge other_map into this_map and destroy other_map.
+ * Merge other_map into this_map and destroy other_map.  If the merge
+ * performs at least CILK_MERGE_THRESHOLD reductions, idle workers may
+ * perform some of them; see cilkred_map_merge_help.
  */
 CHEETAH_INTERNAL
 void cilkred_map_merge(cilkred_map *this_map, __cilkrts_worker *w,
                        cilkred_map *other_map, merge_kind kind);
 
+/**
+ * Perform reductions of a merge running on victim, if it is sharing one.
+ * Called by idle workers in place of a steal attempt.
+ *
+ * @return true if w helped with the merge.
+ */
+CHEETAH_INTERNAL
+bool cilkred_map_merge_help(__cilkrts_worker *w, __cilkrts_worker *victim);
+
 /** @brief Test whether the cilkred_map is empty */
 CHEETAH_INTERNAL
 bool cilkred_map_is_empty(cilkred_map *this_map);
@@ -94,21 +205,52 @@ size_t cilkred_map_num_views(cilkred_map *this_map);
 CHEETAH_INTERNAL
 bool cilkred_map_is_leftmost(cilkred_map *this_map);
 
+/** @brief Mark the cilkred_map as holding the leftmost views */
+CHEETAH_INTERNAL
+void cilkred_map_set_leftmost(cilkred_map *this_map);
+
 #if COMM_REDUCER
 
 struct com_cilkred_map {
-    hyper_id_t spa_cap;
-    ViewInfo *vinfo;
+    hyper_id_t num_of_pages; // length of pages, grows on demand
+    // Pages of SPA_PAGE_VINFO views, or NULL.  Only the directory moves
+    // when the map grows, so pointers to views stay valid.
+    ViewInfo **pages;
 };
 typedef struct com_cilkred_map com_cilkred_map;
 
+/* Return the entry for id, or NULL if its page is not allocated. */
+static inline ViewInfo *com_cilkred_map_vinfo(com_cilkred_map *this_map,
+                                              hyper_id_t id) {
+    hyper_id_t page = id / SPA_PAGE_VINFO;
+    if (page >= this_map->num_of_pages || !this_map->pages[page])
+        return NULL;
+    return &this_map->pages[page][id % SPA_PAGE_VINFO];
+}
+
 CHEETAH_INTERNAL
 ViewInfo *com_cilkred_map_lookup(com_cilkred_map *this_map,
                                  __cilkrts_hyperobject_base *key);
 
+/** @brief Return the entry for id, allocating its page if necessary.  The
+ *  entry is empty unless id is in the map. */
+CHEETAH_INTERNAL
+ViewInfo *com_cilkred_map_vinfo_alloc(__cilkrts_worker *const w,
+                                      com_cilkred_map *this_map, hyper_id_t id);
+
 CHEETAH_INTERNAL
 com_cilkred_map *com_cilkred_map_make_map(__cilkrts_worker *w, size_t size);
 
+CHEETAH_INTERNAL
+void com_cilkred_map_free(__cilkrts_worker *w, com_cilkred_map *this_map);
+
+/** @brief Reduce views[1..n-1] into views[0] on the calling thread.  If
+ *  keep is set, the reduced views are reset to the identity rather than
+ *  freed. */
+CHEETAH_INTERNAL
+void com_cilkred_map_merge_views(__cilkrts_worker *w, ViewInfo **views,
+                                 size_t n, bool keep);
+
 #endif
 
 #endif
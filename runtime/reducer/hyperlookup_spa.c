@@ -22,8 +22,6 @@ void *__cilkrts_hyper_lookup(__cilkrts_hyperobject_base *key) {
         return (char *)key + key->__view_offset;
     }
 
-    /* TODO: If this is the first reference to a reducer created at
-       global scope, install the leftmost view. */
 #if !PRUNE_BRANCHES
     if (w->g->options.force_reduce) {
 #if SLOWPATH_LOOKUP || INLINE_FULL_LOOKUP
@@ -49,16 +47,11 @@ void *__cilkrts_hyper_lookup(__cilkrts_hyperobject_base *key) {
 #if !INLINE_MAP_LOOKUP
     ViewInfo *vinfo = cilkred_map_lookup(h, key);
 #else
-    ViewInfo *vinfo;
-    
-    if (id >= h->spa_cap) {
-        vinfo = NULL; /* TODO: grow map */
-        inline_cilkrts_bug(w, "Error: illegal reducer ID (exceeds SPA cap)");
-    } else {
-        vinfo = h->vinfo + id;
-        if (vinfo->key == NULL && vinfo->val == NULL) {
-            vinfo = NULL;
-        }
+    /* NULL if no page yet, or in a hash map */
+    ViewInfo *vinfo = cilkred_map_vinfo(h, id);
+
+    if (vinfo != NULL && vinfo->key == NULL && vinfo->val == NULL) {
+        vinfo = NULL;
     }
 #endif
 
@@ -66,17 +59,24 @@ void *__cilkrts_hyper_lookup(__cilkrts_hyperobject_base *key) {
 #if SLOWPATH_LOOKUP || INLINE_FULL_LOOKUP
         vinfo = hyperlookup_slowpath(key, w, h, id);
 #else
-        CILK_ASSERT(w, id < h->spa_cap);
-        vinfo = &h->vinfo[id];
-        CILK_ASSERT(w, vinfo->key == NULL && vinfo->val == NULL);
-
-        void *val = key->__c_monoid.allocate_fn(key, key->__view_size);
-        key->__c_monoid.identity_fn(key, val);
-
-        // allocate space for the val and initialize it to identity
-        vinfo->key = key;
-        vinfo->val = val;
-        cilkred_map_log_id(w, h, id);
+        vinfo = cilkred_map_lookup(h, key);
+        if (vinfo == NULL) {
+            void *val;
+            if (h->is_leftmost) {
+                // use the leftmost view directly
+                val = (char *)key + (ptrdiff_t)key->__view_offset;
+            } else {
+                // allocate space for the val and initialize it to identity
+                val = key->__c_monoid.allocate_fn(key, key->__view_size);
+                key->__c_monoid.identity_fn(key, val);
+            }
+
+            vinfo = cilkred_map_vinfo_alloc(w, h, id);
+            CILK_ASSERT(w, vinfo->key == NULL && vinfo->val == NULL);
+            vinfo->key = key;
+            vinfo->val = val;
+            cilkred_map_log_id(w, h, id);
+        }
 #endif
     }
     return vinfo->val;
@@ -118,21 +118,14 @@ void *__cilkrts_hyper_lookup_com(__cilkrts_hyperobject_base *key) {
 #if !INLINE_MAP_LOOKUP
     ViewInfo *vinfo = com_cilkred_map_lookup(h, key);
 #else
-    ViewInfo *vinfo;
-    
-    if (id >= h->spa_cap) {
-        vinfo = NULL; /* TODO: grow map */
-        inline_cilkrts_bug(w, "Error: illegal reducer ID (exceeds SPA cap)");
-    } else {
-        vinfo = h->vinfo + id;
-        if (vinfo->key == NULL && vinfo->val == NULL) {
-            vinfo = NULL;
-        }
+    ViewInfo *vinfo = com_cilkred_map_vinfo(h, id);
+
+    if (vinfo && vinfo->key == NULL && vinfo->val == NULL) {
+        vinfo = NULL;
     }
 #endif
     if (vinfo == NULL) {
-        CILK_ASSERT(w, id < h->spa_cap);
-        vinfo = &h->vinfo[id];
+        vinfo = com_cilkred_map_vinfo_alloc(w, h, id);
 
         void *val = key->__c_monoid.allocate_fn(key, key->__view_size);
         key->__c_monoid.identity_fn(key, val);
@@ -15,6 +15,7 @@
 
 CHEETAH_INTERNAL void reducers_init(global_state *);
 CHEETAH_INTERNAL void reducers_import(global_state *, __cilkrts_worker *);
+CHEETAH_INTERNAL void reducers_enter(__cilkrts_worker *);
 CHEETAH_INTERNAL void reducers_deinit(global_state *);
 
 // used by the scheduler
@@ -33,4 +34,13 @@ cilkred_map *__cilkrts_internal_merge_two_rmaps(__cilkrts_worker *const,
                                                 cilkred_map *left,
                                                 cilkred_map *right);
 
+#if DEFERRED_REDUCE
+// Append the chain of maps right to the chain left without reducing.
+CHEETAH_INTERNAL cilkred_map *chain_rmaps(cilkred_map *left,
+                                          cilkred_map *right);
+// Reduce a chain of maps to a single map.
+CHEETAH_INTERNAL cilkred_map *reduce_rmap_chain(__cilkrts_worker *const,
+                                                cilkred_map *chain);
+#endif
+
 #endif // _REDUCER_IMPL_H
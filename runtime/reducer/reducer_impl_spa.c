@@ -8,10 +8,12 @@
 #include "global.h"
 #include "init.h"
 #include "internal-malloc.h"
+#include "local.h"
 #include "mutex.h"
 #include "scheduler.h"
 #include <assert.h>
 #include <dlfcn.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -20,6 +22,8 @@
 
 #define USE_INTERNAL_MALLOC 1
 
+/* Initial capacity of the ID manager and reducer maps.  Both grow when
+   more reducers are registered at once. */
 #if BIG_SPA
 #define REDUCER_LIMIT 8192U
 #else
@@ -36,15 +40,32 @@ extern __thread __cilkrts_worker *tls_worker;
 // ID managers for reducers
 // =================================================================
 
+/* IDs are handed out without locking.  The used bitmap is split into
+   segments that never move: segment 0 holds the first base_cap IDs and
+   segment i > 0 holds IDs base_cap << (i - 1) up to base_cap << i.  Each
+   worker keeps a small sorted cache of free IDs, refilled a batch at a
+   time from the lowest free bits of the bitmap, and reuses its lowest
+   cached ID first, so IDs stay dense and SPA pages stay few.  The mutex
+   is only taken to add a segment and to track reducers registered
+   before Cilk starts. */
+#define ID_SEGMENTS 24
+#define ID_BATCH (REDUCER_ID_CACHE_SIZE / 2)
+
+typedef _Atomic(unsigned long) id_word;
+
 /* This structure may need to exist before Cilk is started.
  */
 typedef struct reducer_id_manager {
     pthread_mutex_t mutex; // enfore mutual exclusion on access to this desc
     worker_id mutex_owner; // worker id who holds the mutex
-    hyper_id_t spa_cap;
-    hyper_id_t next; // a hint
-    hyper_id_t hwm;  // one greater than largest ID ever used
-    unsigned long *used;
+    // Number of IDs, and size of new reducer maps.  Only raised, with the
+    // mutex held, after the new segment is in place.
+    _Atomic(hyper_id_t) spa_cap;
+    hyper_id_t base_cap; // IDs in segment 0
+    // Lowest word of the bitmap that may have a free bit, a hint.
+    _Atomic(hyper_id_t) first_free;
+    hyper_id_t hwm; // one greater than largest ID in global
+    id_word *used[ID_SEGMENTS];
     /* When Cilk is not running, global holds all the registered
        hyperobjects so they can be imported into the first worker.
        Size is GLOBAL_REDUCER_LIMIT, regardless of spa_cap.   */
@@ -86,22 +107,21 @@ static reducer_id_manager *init_reducer_id_manager(hyper_id_t cap) {
     cap = (cap + LONG_BIT - 1) / LONG_BIT * LONG_BIT; /* round up */
     CILK_ASSERT_G(cap > 0 && cap < 9999999);
     pthread_mutex_init(&m->mutex, NULL);
-    m->spa_cap = cap;
-    m->next = 0;
+    atomic_init(&m->spa_cap, cap);
+    m->base_cap = cap;
+    atomic_init(&m->first_free, 0);
     m->hwm = 0;
-    m->used = calloc(cap / LONG_BIT, sizeof(unsigned long));
+    m->used[0] = calloc(cap / LONG_BIT, sizeof(id_word));
     m->global = NULL;
     return m;
 }
 
 static void free_reducer_id_manager(reducer_id_manager *m) {
     m->spa_cap = 0;
-    m->next = 0;
     m->hwm = 0;
-    unsigned long *old = m->used;
-    if (old) {
-        m->used = NULL;
-        free(old);
+    for (unsigned i = 0; i < ID_SEGMENTS; ++i) {
+        free(m->used[i]);
+        m->used[i] = NULL;
     }
     __cilkrts_hyperobject_base **global = m->global;
     if (global) {
@@ -111,51 +131,159 @@ static void free_reducer_id_manager(reducer_id_manager *m) {
     free(m);
 }
 
-static hyper_id_t reducer_id_get(reducer_id_manager *m, __cilkrts_worker *w) {
+/* Word of the bitmap holding bits word * LONG_BIT and up. */
+static inline id_word *id_word_at(reducer_id_manager *m, hyper_id_t word) {
+    hyper_id_t base = m->base_cap / LONG_BIT;
+    if (word < base)
+        return &m->used[0][word];
+    unsigned seg = 32 - __builtin_clz(word / base);
+    return &m->used[seg][word - (base << (seg - 1))];
+}
+
+/* Double the number of IDs by adding a segment, unless another thread
+   has already done so since cap was read.  Maps created earlier grow
+   when they first see one of the new IDs. */
+static void reducer_id_grow(reducer_id_manager *m, __cilkrts_worker *w,
+                            hyper_id_t cap) {
     reducer_id_manager_lock(m, w);
-    hyper_id_t id = m->next;
-    unsigned long mask = 1UL << (id % LONG_BIT);
-    unsigned long *used = m->used;
-    if ((used[id / LONG_BIT] & mask) == 0) {
-        used[id / LONG_BIT] |= mask;
-    } else {
-        id = ~(hyper_id_t)0;
-        hyper_id_t cap = m->spa_cap;
-        for (unsigned i = 0; i < cap / LONG_BIT; ++i) {
-            if (~used[i]) {
-                int index = __builtin_ctzl(~used[i]);
-                CILK_ASSERT(w, !(used[i] & (1UL << index)));
-                used[i] |= 1UL << index;
-                id = i * LONG_BIT + index;
-                break;
+    hyper_id_t old_cap = m->spa_cap;
+    if (old_cap == cap) {
+        if (old_cap >= HYPER_ID_VALID / 2)
+            cilkrts_bug(w, "Too many reducers (%lu)", (unsigned long)old_cap);
+        unsigned seg = 32 - __builtin_clz(old_cap / m->base_cap);
+        CILK_ASSERT(w, seg < ID_SEGMENTS && !m->used[seg]);
+        m->used[seg] = calloc(old_cap / LONG_BIT, sizeof(id_word));
+        if (!m->used[seg])
+            cilkrts_bug(w, "Unable to grow reducer ID map to %lu",
+                        (unsigned long)(2 * old_cap));
+        atomic_store_explicit(&m->spa_cap, 2 * old_cap, memory_order_release);
+        cilkrts_alert(REDUCE_ID, w, "grew reducer ID map from %lu to %lu",
+                      (unsigned long)old_cap, (unsigned long)(2 * old_cap));
+    }
+    reducer_id_manager_unlock(m, w);
+}
+
+/* Lower the first_free hint to word. */
+static inline void reducer_id_lower_hint(reducer_id_manager *m,
+                                         hyper_id_t word) {
+    hyper_id_t hint = atomic_load_explicit(&m->first_free,
+                                           memory_order_relaxed);
+    while (word < hint &&
+           !atomic_compare_exchange_weak_explicit(&m->first_free, &hint, word,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+        ;
+}
+
+/* Claim up to want of the lowest free IDs, in increasing order, adding
+   capacity if there are none. */
+static unsigned reducer_id_claim(reducer_id_manager *m, __cilkrts_worker *w,
+                                 hyper_id_t *ids, unsigned want) {
+    while (true) {
+        hyper_id_t cap =
+            atomic_load_explicit(&m->spa_cap, memory_order_acquire);
+        hyper_id_t words = cap / LONG_BIT;
+        hyper_id_t start =
+            atomic_load_explicit(&m->first_free, memory_order_relaxed);
+        // If the hint skipped IDs freed behind it, rescan from the start.
+        for (int pass = start ? 0 : 1; pass < 2; ++pass) {
+            for (hyper_id_t i = pass ? 0 : start; i < words; ++i) {
+                id_word *p = id_word_at(m, i);
+                unsigned long old =
+                    atomic_load_explicit(p, memory_order_relaxed);
+                while (~old) {
+                    unsigned long take = 0, free_bits = ~old;
+                    unsigned n = 0;
+                    while (free_bits && n < want) {
+                        take |= free_bits & -free_bits;
+                        free_bits &= free_bits - 1;
+                        ++n;
+                    }
+                    if (atomic_compare_exchange_weak_explicit(
+                            p, &old, old | take, memory_order_acquire,
+                            memory_order_relaxed)) {
+                        if (i > start || (old | take) == ~0UL) {
+                            hyper_id_t next = (old | take) == ~0UL ? i + 1 : i;
+                            atomic_compare_exchange_strong_explicit(
+                                &m->first_free, &start, next,
+                                memory_order_relaxed, memory_order_relaxed);
+                        }
+                        for (unsigned k = 0; k < n; ++k) {
+                            ids[k] = i * LONG_BIT + __builtin_ctzl(take);
+                            take &= take - 1;
+                        }
+                        return n;
+                    }
+                }
             }
         }
+        reducer_id_grow(m, w, cap);
     }
-    cilkrts_alert(REDUCE_ID, w, "allocate reducer ID %lu", (unsigned long)id);
-    m->next = id + 1 >= m->spa_cap ? 0 : id + 1;
-    if (id >= m->hwm)
-        m->hwm = id + 1;
-    if (id >= m->spa_cap) {
-        cilkrts_bug(w, "SPA resize not supported yet! (cap %lu)",
-                    (unsigned long)m->spa_cap);
+}
+
+static void reducer_id_release(reducer_id_manager *m, __cilkrts_worker *w,
+                               hyper_id_t id) {
+    CILK_ASSERT(w, id < m->spa_cap);
+    unsigned long mask = 1UL << (id % LONG_BIT);
+    unsigned long old = atomic_fetch_and_explicit(
+        id_word_at(m, id / LONG_BIT), ~mask, memory_order_release);
+    CILK_ASSERT(w, old & mask);
+    (void)old;
+    reducer_id_lower_hint(m, id / LONG_BIT);
+}
+
+static hyper_id_t reducer_id_get(reducer_id_manager *m, __cilkrts_worker *w) {
+    hyper_id_t id;
+    if (w) {
+        local_state *l = w->l;
+        if (l->id_cache_size == 0)
+            l->id_cache_size = reducer_id_claim(m, w, l->id_cache, ID_BATCH);
+        // The cache is sorted; hand out the lowest ID.
+        id = l->id_cache[0];
+        --l->id_cache_size;
+        memmove(&l->id_cache[0], &l->id_cache[1],
+                l->id_cache_size * sizeof l->id_cache[0]);
+    } else {
+        reducer_id_claim(m, w, &id, 1);
     }
-    reducer_id_manager_unlock(m, w);
+    cilkrts_alert(REDUCE_ID, w, "allocate reducer ID %lu", (unsigned long)id);
     return id;
 }
 
 static void reducer_id_free(__cilkrts_worker *const ws, hyper_id_t id) {
     global_state *g = ws ? ws->g : default_cilkrts;
     reducer_id_manager *m = g->id_manager;
-    reducer_id_manager_lock(m, ws);
     cilkrts_alert(REDUCE_ID, ws, "free reducer ID %lu of %lu",
                   (unsigned long)id, (unsigned long)m->spa_cap);
     CILK_ASSERT(ws, id < m->spa_cap);
-    CILK_ASSERT(ws, m->used[id / LONG_BIT] & (1UL << id % LONG_BIT));
-    m->used[id / LONG_BIT] &= ~(1UL << id % LONG_BIT);
-    m->next = id;
-    if (m->global && id < GLOBAL_REDUCER_LIMIT)
+    if (m->global && id < GLOBAL_REDUCER_LIMIT) {
+        reducer_id_manager_lock(m, ws);
         m->global[id] = NULL;
-    reducer_id_manager_unlock(m, ws);
+        reducer_id_manager_unlock(m, ws);
+    }
+    if (!ws) {
+        reducer_id_release(m, ws, id);
+        return;
+    }
+    // Keep the lowest IDs in the cache and return the highest one to the
+    // bitmap when the cache is full.
+    local_state *l = ws->l;
+    unsigned n = l->id_cache_size;
+    if (n == REDUCER_ID_CACHE_SIZE) {
+        hyper_id_t last = l->id_cache[n - 1];
+        if (id > last) {
+            reducer_id_release(m, ws, id);
+            return;
+        }
+        reducer_id_release(m, ws, last);
+        --n;
+    }
+    l->id_cache_size = n + 1;
+    while (n > 0 && l->id_cache[n - 1] > id) {
+        l->id_cache[n] = l->id_cache[n - 1];
+        --n;
+    }
+    l->id_cache[n] = id;
 }
 
 // =================================================================
@@ -174,6 +302,11 @@ void reducers_init(global_state *g) {
 
 void reducers_deinit(global_state *g) {
     cilkrts_alert(BOOT, NULL, "(reducers_deinit) Cleaning up reducers");
+    // Cached IDs belong to the ID manager.
+    for (unsigned int i = 0; i < g->options.nproc; ++i) {
+        if (g->workers[i])
+            g->workers[i]->l->id_cache_size = 0;
+    }
     free_reducer_id_manager(g->id_manager);
     g->id_manager = NULL;
 }
@@ -189,13 +322,15 @@ CHEETAH_INTERNAL void reducers_import(global_state *g, __cilkrts_worker *w) {
     for (hyper_id_t i = 0; i < m->hwm; ++i) {
         __cilkrts_hyperobject_base *h = m->global[i];
         if (h) {
-            map->vinfo[i].key = h;
-            map->vinfo[i].val = (char *)h + (ptrdiff_t)h->__view_offset;
+            ViewInfo *vinfo = cilkred_map_vinfo_alloc(w, map, i);
+            vinfo->key = h;
+            vinfo->val = (char *)h + (ptrdiff_t)h->__view_offset;
+            hyper_id_t id = h->__id_num;
+            CILK_ASSERT(w, id & HYPER_ID_VALID);
+            cilkred_map_log_id(w, map, id & ~HYPER_ID_VALID);
         }
-        hyper_id_t id = h->__id_num;
-        CILK_ASSERT(w, id & HYPER_ID_VALID);
-        cilkred_map_log_id(w, map, id & ~HYPER_ID_VALID);
     }
+    cilkred_map_set_leftmost(map);
     w->reducer_map = map;
 }
 
@@ -209,18 +344,31 @@ cilkred_map *install_new_reducer_map(__cilkrts_worker *w) {
     reducer_id_manager *m = g->id_manager;
     cilkred_map *h;
     // MAK: w.out worker mem pools, need to reexamine
-    h = cilkred_map_make_map(w, m->spa_cap);
+    h = cilkred_map_make_map(
+        w, atomic_load_explicit(&m->spa_cap, memory_order_relaxed));
     w->reducer_map = h;
 
-    cilkrts_alert(REDUCE, w, "installed reducer map %p", (void *)h);
+    cilkrts_alert(REDUCE, w, "installed %s reducer map %p", h->ops->name,
+                  (void *)h);
     return h;
 }
 
+/* Called by the worker that starts a Cilkified region.  Its reducer map
+   holds the views of the leftmost strand; a reducer first referenced
+   there, or reduced into it, uses its leftmost view directly. */
+CHEETAH_INTERNAL void reducers_enter(__cilkrts_worker *w) {
+    cilkred_map *h = w->reducer_map;
+    if (!h)
+        h = install_new_reducer_map(w);
+    cilkred_map_set_leftmost(h);
+}
+
 #if COMM_REDUCER
 com_cilkred_map *install_new_com_reducer_map(__cilkrts_worker *w) {
     global_state *g = w->g;
     reducer_id_manager *m = g->id_manager;
-    com_cilkred_map *h = com_cilkred_map_make_map(w, m->spa_cap);
+    com_cilkred_map *h = com_cilkred_map_make_map(
+        w, atomic_load_explicit(&m->spa_cap, memory_order_relaxed));
     w->com_reducer_map = h;
     return h;
 }
@@ -297,10 +445,14 @@ void __cilkrts_hyper_create(__cilkrts_hyperobject_base *key) {
         if (id >= GLOBAL_REDUCER_LIMIT) {
             cilkrts_bug(w, "Global reducer pool exhausted");
         }
+        reducer_id_manager_lock(m, w);
         if (!m->global) {
             m->global = calloc(GLOBAL_REDUCER_LIMIT, sizeof *m->global);
         }
         m->global[id] = key;
+        if (id >= m->hwm)
+            m->hwm = id + 1;
+        reducer_id_manager_unlock(m, w);
         return;
     }
 
@@ -318,7 +470,7 @@ void __cilkrts_hyper_create(__cilkrts_hyperobject_base *key) {
 
     CILK_ASSERT(w, w->reducer_map == h);
 
-    ViewInfo *vinfo = &h->vinfo[id];
+    ViewInfo *vinfo = cilkred_map_vinfo_alloc(w, h, id);
     vinfo->key = key;
     // init with left most view
     vinfo->val = (char *)key + (ptrdiff_t)key->__view_offset;
@@ -341,14 +493,25 @@ ViewInfo * hyperlookup_slowpath(__cilkrts_hyperobject_base *key,
                           __cilkrts_worker *w,
                           cilkred_map *h,
                           hyper_id_t id) {
-    CILK_ASSERT(w, id < h->spa_cap);
-    ViewInfo * vinfo = &h->vinfo[id];
-    CILK_ASSERT(w, vinfo->key == NULL && vinfo->val == NULL);
-
-    void *val = key->__c_monoid.allocate_fn(key, key->__view_size);
-    key->__c_monoid.identity_fn(key, val);
+    // The inline lookup only sees the pages of a SPA map.
+    ViewInfo *vinfo = cilkred_map_lookup(h, key);
+    if (vinfo != NULL)
+        return vinfo;
+
+    void *val;
+    if (cilkred_map_is_leftmost(h)) {
+        // First reference in the leftmost strand, for example to a reducer
+        // created at global scope: use the leftmost view directly.
+        val = (char *)key + (ptrdiff_t)key->__view_offset;
+    } else {
+        // allocate space for the val and initialize it to identity
+        val = key->__c_monoid.allocate_fn(key, key->__view_size);
+        key->__c_monoid.identity_fn(key, val);
+    }
 
-    // allocate space for the val and initialize it to identity
+    // The identity may have added entries, so find the entry only now.
+    vinfo = cilkred_map_vinfo_alloc(w, h, id);
+    CILK_ASSERT(w, vinfo->key == NULL && vinfo->val == NULL);
     vinfo->key = key;
     vinfo->val = val;
     cilkred_map_log_id(w, h, id);
@@ -373,9 +536,6 @@ void *__cilkrts_hyper_lookup_old(__cilkrts_hyperobject_base *key) {
         return (char *)key + key->__view_offset;
     }
 
-    /* TODO: If this is the first reference to a reducer created at
-       global scope, install the leftmost view. */
-
     if (w->g->options.force_reduce) {
         CILK_ASSERT(w, w->g->nworkers == 1);
         promote_own_deque(w);
@@ -392,17 +552,7 @@ void *__cilkrts_hyper_lookup_old(__cilkrts_hyperobject_base *key) {
 
     ViewInfo *vinfo = cilkred_map_lookup(h, key);
     if (vinfo == NULL) {
-        CILK_ASSERT(w, id < h->spa_cap);
-        vinfo = &h->vinfo[id];
-        CILK_ASSERT(w, vinfo->key == NULL && vinfo->val == NULL);
-
-        void *val = key->__c_monoid.allocate_fn(key, key->__view_size);
-        key->__c_monoid.identity_fn(key, val);
-
-        // allocate space for the val and initialize it to identity
-        vinfo->key = key;
-        vinfo->val = val;
-        cilkred_map_log_id(w, h, id);
+        vinfo = hyperlookup_slowpath(key, w, h, id);
     }
     return vinfo->val;
 }
@@ -493,6 +643,51 @@ cilkred_map *__cilkrts_internal_merge_two_rmaps(__cilkrts_worker *const ws,
     }
 }
 
+#if DEFERRED_REDUCE
+cilkred_map *chain_rmaps(cilkred_map *left, cilkred_map *right) {
+    if (!left)
+        return right;
+    if (!right)
+        return left;
+    cilkred_map *left_tail = left->chain_tail ? left->chain_tail : left;
+    left_tail->chain_next = right;
+    left->chain_tail = right->chain_tail ? right->chain_tail : right;
+    right->chain_tail = NULL;
+    return left;
+}
+
+/* Reduce adjacent pairs of maps until one is left, so that each view
+   takes part in at most log2(k) merges of a k-map chain.  A merge with
+   many reductions is shared with idle workers by cilkred_map_merge. */
+cilkred_map *reduce_rmap_chain(__cilkrts_worker *const ws,
+                               cilkred_map *chain) {
+    while (chain && chain->chain_next) {
+        cilkred_map *head = NULL, *tail = NULL;
+        cilkred_map *m = chain;
+        while (m) {
+            cilkred_map *left = m, *right = m->chain_next;
+            m = right ? right->chain_next : NULL;
+            left->chain_next = NULL;
+            left->chain_tail = NULL;
+            if (right) {
+                right->chain_next = NULL;
+                right->chain_tail = NULL;
+                left = merge_two_rmaps(ws, left, right);
+            }
+            if (tail)
+                tail->chain_next = left;
+            else
+                head = left;
+            tail = left;
+        }
+        chain = head;
+    }
+    if (chain)
+        chain->chain_tail = NULL;
+    return chain;
+}
+#endif
+
 
 #if COMM_REDUCER
 void __cilkrts_hyper_create_com(__cilkrts_hyperobject_base *key) {
@@ -523,27 +718,12 @@ void __cilkrts_hyper_create_com(__cilkrts_hyperobject_base *key) {
     CILK_ASSERT(w, w->com_reducer_map == h);
 }
 
-static inline void clear_view(ViewInfo *view) {
-    __cilkrts_hyperobject_base *key = view->key;
-
-    if (key != NULL) {
-        cilk_destroy_fn_t destroy = key->__c_monoid.destroy_fn;
-        if (destroy) {
-            key->__c_monoid.destroy_fn(key, view->val); // calls destructor
-        }
-        key->__c_monoid.deallocate_fn(key, view->val); // free the memory
-    }
-    view->key = NULL;
-    view->val = NULL;
-}
-
-void __cilkrts_hyper_merge_com(__cilkrts_hyperobject_base *key) {
-    // Iterate through all workers (done in global state), reduce into current
-    // worker
-    // This is fine given that there should be no parallel control between
-    // merge and access of the merged value
+/* Reduce every worker's view of key into the current worker's view.  This
+   is fine given that there should be no parallel control between merge and
+   access of the merged value.  If keep is set, the other workers' views are
+   reset to the identity and stay in their maps for the next region. */
+static void merge_com(__cilkrts_hyperobject_base *key, bool keep) {
     __cilkrts_worker *w = __cilkrts_get_tls_worker();
-
     global_state *g;
 
     if (__builtin_expect(!w, 0)) {
@@ -564,32 +744,96 @@ void __cilkrts_hyper_merge_com(__cilkrts_hyperobject_base *key) {
     hyper_id_t id = key->__id_num;
     id &= ~HYPER_ID_VALID;
 
-    for (int i = 0; i < g->options.nproc; i++) {
+    ViewInfo **views =
+        (ViewInfo **)malloc(g->options.nproc * sizeof(ViewInfo *));
+    if (!views)
+        cilkrts_bug(w, "Unable to allocate commutative reducer merge");
+
+    // The current worker's view comes first and receives the result.
+    size_t n = 0;
+    views[n++] = com_cilkred_map_vinfo_alloc(w, map, id);
+
+    for (worker_id i = 0; i < g->options.nproc; i++) {
         if (i == self_id) {
             continue;
         }
-        // reduce together
         __cilkrts_worker *other_w = g->workers[i];
         if (!other_w->com_reducer_map) {
             continue;
         }
-        if (!other_w->com_reducer_map->vinfo[id].val) {
+        ViewInfo *other = com_cilkred_map_vinfo(other_w->com_reducer_map, id);
+        if (!other || !other->val) {
             continue;
         }
-        if (!map->vinfo[id].val) {
-            map->vinfo[id].val = other_w->com_reducer_map->vinfo[id].val;
+        if (!views[0]->val) {
+            // Take over the view instead of sharing it between two maps.
+            views[0]->key = key;
+            views[0]->val = other->val;
+            other->key = NULL;
+            other->val = NULL;
             continue;
         }
-        key->__c_monoid.reduce_fn(key, map->vinfo[id].val,
-                                  other_w->com_reducer_map->vinfo[id].val);
-        // TODO(qq): clear view, which is static inline in another file right now
-        clear_view(&other_w->com_reducer_map->vinfo[id]);
+        views[n++] = other;
     }
+
+    if (n > 1)
+        com_cilkred_map_merge_views(w, views, n, keep);
+    free(views);
+}
+
+void __cilkrts_hyper_merge_com(__cilkrts_hyperobject_base *key) {
+    merge_com(key, false);
+}
+
+void __cilkrts_hyper_merge_com_partial(__cilkrts_hyperobject_base *key) {
+    merge_com(key, true);
+}
+
+void __cilkrts_hyper_destroy_com(__cilkrts_hyperobject_base *key) {
+    __cilkrts_worker *w = __cilkrts_get_tls_worker();
+    global_state *g;
+
+    if (__builtin_expect(!w, 0)) {
+        g = default_cilkrts;
+        w = g->workers[g->exiting_worker];
+    } else {
+        g = w->g;
+    }
+
+    hyper_id_t id = key->__id_num;
+    cilkrts_alert(REDUCE_ID, w, "Destroy commutative reducer %x at %p",
+                  (unsigned)id, key);
+    if (!__builtin_expect(id & HYPER_ID_VALID, HYPER_ID_VALID)) {
+        cilkrts_bug(w, "unregistering unregistered hyperobject %p", key);
+        return;
+    }
+    id &= ~HYPER_ID_VALID;
+    key->__id_num = id;
+
+    // Free every worker's view; the id may be reused by the next reducer.
+    for (unsigned int i = 0; i < g->options.nproc; i++) {
+        com_cilkred_map *map = g->workers[i]->com_reducer_map;
+        ViewInfo *view = map ? com_cilkred_map_vinfo(map, id) : NULL;
+        if (!view)
+            continue;
+        if (view->val) {
+            if (key->__c_monoid.destroy_fn)
+                key->__c_monoid.destroy_fn(key, view->val);
+            key->__c_monoid.deallocate_fn(key, view->val);
+        }
+        view->key = NULL;
+        view->val = NULL;
+    }
+    reducer_id_free(w, id);
 }
 
 void *__cilkrts_hyper_alloc_com(__cilkrts_hyperobject_base *key, size_t bytes) {
-    // MAK: almost certainly overkill, but no more than one view per cache line
-    return cilk_aligned_alloc(16, bytes);
+    // Give each view its own cache lines so that workers updating their
+    // views never share a line.  The view is allocated and initialized by
+    // identity_fn on the worker that uses it, so under a first-touch policy
+    // its pages are also local to that worker's NUMA node.
+    size_t size = (bytes + CILK_CACHE_LINE - 1) & ~(size_t)(CILK_CACHE_LINE - 1);
+    return cilk_aligned_alloc(CILK_CACHE_LINE, size ? size : CILK_CACHE_LINE);
 }
 
 void __cilkrts_hyper_dealloc_com(__cilkrts_hyperobject_base *key, void *view) {
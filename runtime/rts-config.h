@@ -51,6 +51,14 @@
 #define DEFAULT_FIBER_POOL_CAP 128  // initial per-worker fiber pool capacity
 #define DEFAULT_REDUCER_LIMIT 1024
 #define DEFAULT_FORCE_REDUCE 0 // do not self steal to force reduce
+#define DEFAULT_TRIM_MEMORY (16 * 1024 * 1024) // free bytes kept per node pool
+#define DEFAULT_TRIM_FIBERS 128 // free fibers kept in the global fiber pool
+#define DEFAULT_TRIM_REGIONS 0 // trim at the end of every Cilkified region
+#define DEFAULT_MERGE_THRESHOLD 0 // reductions to share a merge, 0 never
+#define DEFAULT_REDUCER_MAP REDUCER_MAP_SPA // SPA or hash reducer maps
 
 #define MAX_CALLBACKS 32 // Maximum number of init or exit callbacks
+#define REDUCER_MAP_CACHE_SIZE 16 // destroyed reducer maps kept per worker
+#define REDUCER_ID_CACHE_SIZE 16 // free reducer IDs kept per worker
+#define REDUCER_MERGE_GRAIN 16 // reductions claimed at once by a merge helper
 #endif                   // _CONFIG_H
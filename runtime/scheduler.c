@@ -19,6 +19,9 @@
 #include "reducer_impl.h"
 
 __thread __cilkrts_worker *tls_worker = NULL;
+/* Read by __cilkrts_hyper_lookup_inline; NULL sends every lookup to the
+   out-of-line path. */
+__thread void *const *__cilkrts_tls_hyper_table = NULL;
 
 // ==============================================
 // Misc. helper functions
@@ -175,6 +178,14 @@ __cilkrts_worker *__cilkrts_get_tls_worker() { return tls_worker; }
 
 CHEETAH_INTERNAL void __cilkrts_set_tls_worker(__cilkrts_worker *w) {
     tls_worker = w;
+    // Forced reductions must see every lookup, and the inline lookup can
+    // only read a SPA map.  The options cannot change while workers are
+    // running.
+    __cilkrts_tls_hyper_table =
+        w && !w->g->options.force_reduce &&
+                w->g->options.reducer_map == REDUCER_MAP_SPA
+            ? (void *const *)&w->reducer_map
+            : NULL;
 }
 
 // ==============================================
@@ -331,6 +342,10 @@ static Closure *provably_good_steal_maybe(__cilkrts_worker *const w,
  * right_rmap may have something new again.  If that's the case, we
  * need to do the reduce again (in deposit_reducer_map).
  *
+ * With DEFERRED_REDUCE the child instead splices the maps into a chain in
+ * serial order, and the chain is reduced when the parent syncs; see
+ * doc/REDUCER_PROTOCOL.
+ *
  * This function returns a closure to be executed next, or NULL if none.
  * The child must not be locked by ourselves, and be in no deque.
  ***/
@@ -426,6 +441,32 @@ Closure *Closure_return(__cilkrts_worker *const w, Closure *child) {
         Closure_lock(w, child);
     }
 
+#if DEFERRED_REDUCE
+    {
+        // Chain the maps in serial order without reducing them; the
+        // chain is reduced when the parent syncs.  Nothing is reduced
+        // here, so the locks are held throughout and no retry is needed.
+        cilkred_map *right =
+            atomic_load_explicit(&child->right_rmap, memory_order_acquire);
+        atomic_store_explicit(&child->right_rmap, NULL, memory_order_relaxed);
+        _Atomic(cilkred_map *) volatile *left_ptr;
+        Closure *const left_sib = child->left_sib;
+        if (left_sib != NULL) {
+            left_ptr = &left_sib->right_rmap;
+        } else {
+            left_ptr = &parent->child_rmap;
+        }
+        cilkred_map *left =
+            atomic_load_explicit(left_ptr, memory_order_acquire);
+
+        cilkred_map *active = w->reducer_map;
+        w->reducer_map = NULL;
+
+        atomic_store_explicit(left_ptr,
+                              chain_rmaps(chain_rmaps(left, active), right),
+                              memory_order_release);
+    }
+#else
     while (1) {
         // invariant: a closure cannot unlink itself w/out lock on parent
         // so what this points to cannot change while we have lock on parent
@@ -463,6 +504,7 @@ Closure *Closure_return(__cilkrts_worker *const w, Closure *child) {
         Closure_lock(w, parent);
         Closure_lock(w, child);
     }
+#endif
 
     /* The returning closure and its parent are locked. */
 
@@ -532,7 +574,11 @@ Closure *Closure_return(__cilkrts_worker *const w, Closure *child) {
         cilkred_map *active = parent->user_rmap;
         atomic_store_explicit(&parent->child_rmap, NULL, memory_order_relaxed);
         parent->user_rmap = NULL;
+#if DEFERRED_REDUCE
+        w->reducer_map = reduce_rmap_chain(w, chain_rmaps(child, active));
+#else
         w->reducer_map = merge_two_rmaps(w, child, active);
+#endif
 
         if (parent->simulated_stolen) {
             atomic_store_explicit(&parent->child_rmap, w->reducer_map,
@@ -1301,7 +1347,12 @@ int Cilk_sync(__cilkrts_worker *const w, __cilkrts_stack_frame *frame) {
         if (child_rmap) {
             atomic_store_explicit(&t->child_rmap, NULL, memory_order_relaxed);
             /* reducer_map may be accessed without lock */
+#if DEFERRED_REDUCE
+            w->reducer_map = reduce_rmap_chain(
+                w, chain_rmaps(child_rmap, w->reducer_map));
+#else
             w->reducer_map = merge_two_rmaps(w, child_rmap, w->reducer_map);
+#endif
         }
         if (t->simulated_stolen)
             t->simulated_stolen = false;
@@ -1412,8 +1463,13 @@ void worker_scheduler(__cilkrts_worker *w, Closure *t) {
             CILK_START_TIMING(w, INTERVAL_SCHED);
             CILK_START_TIMING(w, INTERVAL_IDLE);
             unsigned int victim = rts_rand(w) % w->g->nworkers;
+            bool helped = false;
             if (victim != w->self) {
-                t = Closure_steal(w, victim);
+                // A victim merging many reducer views has work to share
+                // even if its deque is empty.
+                helped = cilkred_map_merge_help(w, w->g->workers[victim]);
+                if (!helped)
+                    t = Closure_steal(w, victim);
             }
 #if SCHED_STATS
             if (t) { // steal successful
@@ -1428,6 +1484,10 @@ void worker_scheduler(__cilkrts_worker *w, Closure *t) {
                 fails = 0;
                 break;
             }
+            if (helped) {
+                fails = 0;
+                continue;
+            }
             /* TODO: Use condition variables or a similar controlled
                blocking mechanism.  When a thread finds something to steal
                it should wake up another thread to enter the loop. */
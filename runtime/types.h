@@ -13,7 +13,7 @@ typedef struct __cilkrts_stack_frame __cilkrts_stack_frame;
 typedef struct global_state global_state;
 typedef struct cilkred_map cilkred_map;
 
-#if COMM_REDUCER && ! HASH_REDUCER
+#if COMM_REDUCER
 typedef struct com_cilkred_map com_cilkred_map;
 #endif
 